@@ -0,0 +1,52 @@
+#include "AlgorithmTrace.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+void AlgorithmTrace::finish()
+{
+    GV_TRACE_SCOPE("AlgorithmTrace::finish");
+    // A keyframe costs nodes + edges bytes; spacing them that far apart
+    // keeps all keyframes together about the size of the log itself.
+    interval = std::max(4096, (nodes + edges) / 4);
+    keyframes.clear();
+
+    std::vector<quint8> nodeStates(nodes, Node_Unseen);
+    std::vector<quint8> edgeStates(edges, Edge_Untouched);
+    for (int position = 0; position <= size(); ++position) {
+        if (position % interval == 0) keyframes.push_back(Keyframe{nodeStates, edgeStates});
+        if (position < size()) apply(events[position], nodeStates, edgeStates);
+    }
+}
+
+void AlgorithmTrace::stateAt(int position, std::vector<quint8> &nodeStates, std::vector<quint8> &edgeStates) const
+{
+    position = std::clamp(position, 0, size());
+    int start = 0;
+    if (keyframes.empty()) {
+        nodeStates.assign(nodes, Node_Unseen);
+        edgeStates.assign(edges, Edge_Untouched);
+    } else {
+        const Keyframe& keyframe = keyframes[position / interval];
+        nodeStates = keyframe.nodeStates;
+        edgeStates = keyframe.edgeStates;
+        start = (position / interval) * interval;
+    }
+    for (int i = start; i < position; ++i) apply(events[i], nodeStates, edgeStates);
+}
+
+void AlgorithmTrace::apply(const TraceEvent &event, std::vector<quint8> &nodeStates, std::vector<quint8> &edgeStates)
+{
+    switch (event.kind()) {
+    case Settle_Event:
+        nodeStates[event.node] = Node_Settled;
+        break;
+    case Improve_Event:
+        edgeStates[event.edge()] = Edge_Improved;
+        if (nodeStates[event.node] == Node_Unseen) nodeStates[event.node] = Node_Labeled;
+        break;
+    case Relax_Event:
+        if (edgeStates[event.edge()] == Edge_Untouched) edgeStates[event.edge()] = Edge_Relaxed;
+        break;
+    }
+}
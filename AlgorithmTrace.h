@@ -0,0 +1,71 @@
+#ifndef ALGORITHMTRACE_H
+#define ALGORITHMTRACE_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+enum TraceEventKind{
+    Settle_Event,       // node popped from the queue
+    Relax_Event,        // edge examined, no better label
+    Improve_Event       // edge gave its head a better label
+};
+
+// One search step in 8 bytes: the node settled or reached, and the edge
+// id with the kind packed into its top two bits.
+struct TraceEvent {
+    quint32 node;
+    quint32 packed;
+
+    TraceEventKind kind() const { return TraceEventKind(packed >> 30); }
+    int edge() const { return (packed & kEdgeMask) == kEdgeMask ? -1 : int(packed & kEdgeMask); }
+
+    static constexpr quint32 kEdgeMask = 0x3FFFFFFFu;
+};
+
+// Event log of one search, recorded through SearchControl::trace.
+//
+// Recording is a push_back per step, so searches keep running at full
+// speed; everything visual happens later in TracePlayer. finish() adds
+// keyframes of the node and edge states so any position can be restored
+// by replaying at most keyframeInterval() events.
+class AlgorithmTrace {
+public:
+    enum NodeState : quint8 { Node_Unseen, Node_Labeled, Node_Settled };
+    enum EdgeState : quint8 { Edge_Untouched, Edge_Relaxed, Edge_Improved };
+
+    AlgorithmTrace(int nodeCount, int edgeCount) : nodes(nodeCount), edges(edgeCount) {}
+
+    void settle(int node) {
+        events.push_back(TraceEvent{quint32(node), quint32(Settle_Event) << 30 | TraceEvent::kEdgeMask});
+    }
+    void relax(int edge, int head, bool improved) {
+        const quint32 kind = improved ? Improve_Event : Relax_Event;
+        events.push_back(TraceEvent{quint32(head), kind << 30 | quint32(edge)});
+    }
+    void finish();
+
+    int nodeCount() const { return nodes; }
+    int edgeCount() const { return edges; }
+    int size() const { return int(events.size()); }
+    const TraceEvent& event(int index) const { return events[index]; }
+    int keyframeInterval() const { return interval; }
+
+    // States after the first `position` events
+    void stateAt(int position, std::vector<quint8>& nodeStates, std::vector<quint8>& edgeStates) const;
+    static void apply(const TraceEvent& event, std::vector<quint8>& nodeStates, std::vector<quint8>& edgeStates);
+
+private:
+    struct Keyframe {
+        std::vector<quint8> nodeStates;
+        std::vector<quint8> edgeStates;
+    };
+
+    int nodes;
+    int edges;
+    std::vector<TraceEvent> events;
+    int interval = 0;
+    std::vector<Keyframe> keyframes;    // keyframes[k] is the state after k * interval events
+};
+
+#endif // ALGORITHMTRACE_H
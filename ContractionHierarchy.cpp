@@ -0,0 +1,469 @@
+#include "ContractionHierarchy.h"
+#include "IndexedHeap.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+// Witness searches give up after this many settled nodes; a missed
+// witness only costs an unnecessary shortcut, never a wrong distance.
+// Priority estimates use a tighter limit than actual contractions.
+const int kWitnessSettleLimit = 500;
+const int kEstimateSettleLimit = 16;
+// In-neighbours per task when the witness searches of one node are split
+const int kWitnessGrain = 8;
+
+struct Link {
+    int node;
+    double weight;
+    int arc;
+};
+
+struct Shortcut {
+    int source;
+    int target;
+    double weight;
+    int first;
+    int second;
+};
+
+// Remaining (uncontracted) graph during preprocessing
+struct Overlay {
+    std::vector<std::vector<Link>> out;
+    std::vector<std::vector<Link>> in;
+
+    // Adds u->v or lowers the weight of an existing u->v link
+    void connect(int u, int v, double weight, int arc) {
+        for (Link& link : out[u]) {
+            if (link.node != v) continue;
+            if (weight < link.weight) {
+                link.weight = weight;
+                link.arc = arc;
+                for (Link& back : in[v]) {
+                    if (back.node == u) back = Link{u, weight, arc};
+                }
+            }
+            return;
+        }
+        out[u].push_back(Link{v, weight, arc});
+        in[v].push_back(Link{u, weight, arc});
+    }
+};
+
+// Bounded Dijkstra over the overlay that skips the node being contracted.
+// One per thread; only the entries a run touched are reset.
+struct WitnessSearch {
+    std::vector<double> dist;
+    std::vector<char> wanted;
+    std::vector<int> touched;
+    IndexedHeap<4> queue;
+
+    // Stops early once every node flagged in `wanted` is settled
+    void run(const Overlay& overlay, int source, int avoid, double limit, int settleLimit, int targets) {
+        const int n = int(overlay.out.size());
+        if (int(dist.size()) != n) {
+            dist.assign(n, kInfinity);
+            queue.resize(n);
+        } else {
+            for (int node : touched) dist[node] = kInfinity;
+            queue.clear();
+        }
+        touched.clear();
+
+        dist[source] = 0;
+        touched.push_back(source);
+        queue.push(source, 0);
+        int settled = 0;
+        while (!queue.empty() && queue.topKey() <= limit && settled < settleLimit && targets > 0) {
+            const int current = queue.pop();
+            ++settled;
+            if (wanted[current]) --targets;
+            const double base = dist[current];
+            for (const Link& link : overlay.out[current]) {
+                if (link.node == avoid) continue;
+                const double alt = base + link.weight;
+                if (alt < dist[link.node]) {
+                    if (dist[link.node] == kInfinity) touched.push_back(link.node);
+                    dist[link.node] = alt;
+                    queue.pushOrDecrease(link.node, alt);
+                }
+            }
+        }
+    }
+};
+
+WitnessSearch& localSearch()
+{
+    thread_local WitnessSearch search;
+    return search;
+}
+
+// Shortcuts needed through v for paths entering it over `from`
+template <typename Add>
+void shortcutsFrom(const Overlay& overlay, int v, const Link& from, int settleLimit, Add add)
+{
+    WitnessSearch& search = localSearch();
+    if (int(search.wanted.size()) != int(overlay.out.size())) search.wanted.assign(overlay.out.size(), 0);
+
+    double maxOut = 0;
+    int targets = 0;
+    for (const Link& to : overlay.out[v]) {
+        if (to.node == from.node || search.wanted[to.node]) continue;
+        maxOut = std::max(maxOut, to.weight);
+        search.wanted[to.node] = 1;
+        ++targets;
+    }
+    if (targets == 0) return;
+
+    search.run(overlay, from.node, v, from.weight + maxOut, settleLimit, targets);
+    for (const Link& to : overlay.out[v]) search.wanted[to.node] = 0;
+    for (const Link& to : overlay.out[v]) {
+        if (to.node == from.node) continue;
+        const double through = from.weight + to.weight;
+        if (search.dist[to.node] > through) add(Shortcut{from.node, to.node, through, from.arc, to.arc});
+    }
+}
+
+double priority(const Overlay& overlay, int v, int contractedNeighbors)
+{
+    int shortcuts = 0;
+    for (const Link& from : overlay.in[v]) {
+        shortcutsFrom(overlay, v, from, kEstimateSettleLimit, [&](const Shortcut&) { ++shortcuts; });
+    }
+    return shortcuts - int(overlay.in[v].size()) - int(overlay.out[v].size()) + contractedNeighbors;
+}
+
+void unlink(std::vector<Link>& links, int node)
+{
+    links.erase(std::remove_if(links.begin(), links.end(), [node](const Link& link) {
+        return link.node == node;
+    }), links.end());
+}
+
+// Sidecar layout, little-endian:
+//   Header  48 bytes: magic, u32 version, u32 header size, u64 nodeCount,
+//           u64 edgeCount, u64 arcCount, u64 reserved
+//   Ranks   u32[nodeCount], padded to 8 bytes
+//   Arcs    arcCount x { u32 source, u32 target, f64 weight, i32 first, i32 second }
+const char kMagic[8] = {'G', 'V', 'C', 'H', 'I', 'E', 'R', '\0'};
+const quint32 kVersion = 1;
+const int kHeaderSize = 48;
+const int kArcRecordSize = 24;
+
+quint64 align8(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+double readDouble(const uchar* p)
+{
+    quint64 bits = qFromLittleEndian<quint64>(p);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeDouble(uchar* p, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, p);
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) *error = message;
+    return false;
+}
+
+}
+
+ContractionHierarchy::ContractionHierarchy(const GraphModel &graph, const std::atomic<bool> *cancel)
+{
+    GV_TRACE_SCOPE("ContractionHierarchy::build");
+    const int n = graph.nodeCount();
+    originalEdges = graph.edgeCount();
+
+    arcs.reserve(originalEdges * 2);
+    Overlay overlay;
+    overlay.out.resize(n);
+    overlay.in.resize(n);
+    for (int id = 0; id < originalEdges; ++id) {
+        const GraphModel::Edge& edge = graph.edge(id);
+        arcs.push_back(Arc{edge.source, edge.target, edge.weight});
+        if (edge.source != edge.target) overlay.connect(edge.source, edge.target, edge.weight, id);
+    }
+
+    std::vector<int> contractedNeighbors(n, 0);
+    std::vector<double> priorities(n);
+    parallelFor(n, [&](int begin, int end) {
+        for (int v = begin; v < end; ++v) priorities[v] = priority(overlay, v, 0);
+    }, 256);
+
+    IndexedHeap<4> order;
+    order.resize(n);
+    for (int v = 0; v < n; ++v) order.push(v, priorities[v]);
+
+    rank.assign(n, -1);
+    int nextRank = 0;
+    std::vector<std::vector<Shortcut>> found;
+    std::vector<int> neighbors;
+    while (!order.empty()) {
+        if (cancel && nextRank % 1024 == 0 && cancel->load(std::memory_order_relaxed)) {
+            *this = ContractionHierarchy();
+            return;
+        }
+
+        // Priorities of nodes that were not neighbours of recent
+        // contractions may be out of date; re-check before contracting
+        const int v = order.pop();
+        const double current = priority(overlay, v, contractedNeighbors[v]);
+        if (!order.empty() && current > order.topKey()) {
+            order.push(v, current);
+            continue;
+        }
+
+        const std::vector<Link>& in = overlay.in[v];
+        found.assign(in.size(), {});
+        parallelFor(int(in.size()), [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                shortcutsFrom(overlay, v, in[i], kWitnessSettleLimit, [&](const Shortcut& shortcut) { found[i].push_back(shortcut); });
+            }
+        }, kWitnessGrain);
+        for (const std::vector<Shortcut>& shortcuts : found) {
+            for (const Shortcut& shortcut : shortcuts) {
+                overlay.connect(shortcut.source, shortcut.target, shortcut.weight, int(arcs.size()));
+                arcs.push_back(Arc{shortcut.source, shortcut.target, shortcut.weight, shortcut.first, shortcut.second});
+            }
+        }
+
+        neighbors.clear();
+        for (const Link& link : overlay.in[v]) {
+            unlink(overlay.out[link.node], v);
+            neighbors.push_back(link.node);
+        }
+        for (const Link& link : overlay.out[v]) {
+            unlink(overlay.in[link.node], v);
+            neighbors.push_back(link.node);
+        }
+        std::vector<Link>().swap(overlay.in[v]);
+        std::vector<Link>().swap(overlay.out[v]);
+        rank[v] = nextRank++;
+
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        for (int u : neighbors) ++contractedNeighbors[u];
+        // Raised priorities are caught by the re-check when popped
+        parallelFor(int(neighbors.size()), [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                priorities[neighbors[i]] = priority(overlay, neighbors[i], contractedNeighbors[neighbors[i]]);
+            }
+        }, kWitnessGrain);
+        for (int u : neighbors) {
+            if (order.contains(u)) order.pushOrDecrease(u, priorities[u]);
+        }
+    }
+
+    buildSearchGraphs();
+    GV_TRACE_COUNTER("shortcuts", shortcutCount());
+}
+
+void ContractionHierarchy::buildSearchGraphs()
+{
+    const int n = nodeCount();
+    upOffsets.assign(n + 1, 0);
+    downOffsets.assign(n + 1, 0);
+    for (const Arc& a : arcs) {
+        if (a.source == a.target) continue;
+        if (rank[a.source] < rank[a.target]) {
+            ++upOffsets[a.source + 1];
+        } else {
+            ++downOffsets[a.target + 1];
+        }
+    }
+    for (int v = 0; v < n; ++v) {
+        upOffsets[v + 1] += upOffsets[v];
+        downOffsets[v + 1] += downOffsets[v];
+    }
+
+    upTargets.resize(upOffsets[n]);
+    upWeights.resize(upOffsets[n]);
+    upArcs.resize(upOffsets[n]);
+    downSources.resize(downOffsets[n]);
+    downWeights.resize(downOffsets[n]);
+    downArcs.resize(downOffsets[n]);
+
+    std::vector<int> upFill(upOffsets.begin(), upOffsets.end() - 1);
+    std::vector<int> downFill(downOffsets.begin(), downOffsets.end() - 1);
+    for (int id = 0; id < int(arcs.size()); ++id) {
+        const Arc& a = arcs[id];
+        if (a.source == a.target) continue;
+        if (rank[a.source] < rank[a.target]) {
+            const int slot = upFill[a.source]++;
+            upTargets[slot] = a.target;
+            upWeights[slot] = a.weight;
+            upArcs[slot] = id;
+        } else {
+            const int slot = downFill[a.target]++;
+            downSources[slot] = a.source;
+            downWeights[slot] = a.weight;
+            downArcs[slot] = id;
+        }
+    }
+}
+
+void ContractionHierarchy::unpack(int arcId, std::vector<int> &edges) const
+{
+    std::vector<int> stack{arcId};
+    while (!stack.empty()) {
+        const Arc& a = arcs[stack.back()];
+        const int id = stack.back();
+        stack.pop_back();
+        if (a.first < 0) {
+            edges.push_back(id);
+        } else {
+            stack.push_back(a.second);
+            stack.push_back(a.first);
+        }
+    }
+}
+
+bool ContractionHierarchy::save(const QString &fileName, QString *error) const
+{
+    GV_TRACE_SCOPE("ContractionHierarchy::save");
+    const quint64 n = quint64(nodeCount());
+    const quint64 arcsOffset = kHeaderSize + align8(n * 4);
+    QByteArray buffer(int(arcsOffset + arcs.size() * kArcRecordSize), '\0');
+    uchar* out = reinterpret_cast<uchar*>(buffer.data());
+
+    std::memcpy(out, kMagic, sizeof(kMagic));
+    qToLittleEndian<quint32>(kVersion, out + 8);
+    qToLittleEndian<quint32>(kHeaderSize, out + 12);
+    qToLittleEndian<quint64>(n, out + 16);
+    qToLittleEndian<quint64>(quint64(originalEdges), out + 24);
+    qToLittleEndian<quint64>(quint64(arcs.size()), out + 32);
+
+    for (quint64 v = 0; v < n; ++v) {
+        qToLittleEndian<quint32>(quint32(rank[v]), out + kHeaderSize + v * 4);
+    }
+    uchar* record = out + arcsOffset;
+    for (const Arc& a : arcs) {
+        qToLittleEndian<quint32>(quint32(a.source), record);
+        qToLittleEndian<quint32>(quint32(a.target), record + 4);
+        writeDouble(record + 8, a.weight);
+        qToLittleEndian<qint32>(a.first, record + 16);
+        qToLittleEndian<qint32>(a.second, record + 20);
+        record += kArcRecordSize;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+    if (file.write(buffer) != buffer.size() || !file.commit()) {
+        return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+    }
+    return true;
+}
+
+bool ContractionHierarchy::load(const QString &fileName, const GraphModel &graph, QString *error)
+{
+    GV_TRACE_SCOPE("ContractionHierarchy::load");
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail(error, "Cannot open " + fileName + ": " + file.errorString());
+    const QByteArray bytes = file.readAll();
+    const uchar* in = reinterpret_cast<const uchar*>(bytes.constData());
+
+    if (bytes.size() < kHeaderSize || std::memcmp(in, kMagic, sizeof(kMagic)) != 0) {
+        return fail(error, fileName + " is not a contraction hierarchy file");
+    }
+    if (qFromLittleEndian<quint32>(in + 8) != kVersion) return fail(error, fileName + ": unsupported version");
+    const quint64 n = qFromLittleEndian<quint64>(in + 16);
+    const quint64 m = qFromLittleEndian<quint64>(in + 24);
+    const quint64 arcCount = qFromLittleEndian<quint64>(in + 32);
+    if (n != quint64(graph.nodeCount()) || m != quint64(graph.edgeCount()) || arcCount < m) {
+        return fail(error, fileName + " was built for a different graph");
+    }
+    const quint64 arcsOffset = kHeaderSize + align8(n * 4);
+    if (quint64(bytes.size()) != arcsOffset + arcCount * kArcRecordSize) {
+        return fail(error, fileName + " is truncated");
+    }
+
+    std::vector<int> fileRank(n);
+    std::vector<char> seen(n, 0);
+    for (quint64 v = 0; v < n; ++v) {
+        const quint32 r = qFromLittleEndian<quint32>(in + kHeaderSize + v * 4);
+        if (r >= n || seen[r]) return fail(error, fileName + " is corrupted");
+        seen[r] = 1;
+        fileRank[v] = int(r);
+    }
+
+    std::vector<Arc> fileArcs(arcCount);
+    const uchar* record = in + arcsOffset;
+    for (quint64 id = 0; id < arcCount; ++id, record += kArcRecordSize) {
+        Arc& a = fileArcs[id];
+        a.source = int(qFromLittleEndian<quint32>(record));
+        a.target = int(qFromLittleEndian<quint32>(record + 4));
+        a.weight = readDouble(record + 8);
+        a.first = qFromLittleEndian<qint32>(record + 16);
+        a.second = qFromLittleEndian<qint32>(record + 20);
+        const bool original = id < m;
+        const bool halvesValid = original ? a.first == -1 && a.second == -1
+                                          : a.first >= 0 && a.second >= 0 && quint64(a.first) < id && quint64(a.second) < id;
+        if (quint64(a.source) >= n || quint64(a.target) >= n || !halvesValid) {
+            return fail(error, fileName + " is corrupted");
+        }
+    }
+
+    // Match the stored original edges to the graph's edge ids
+    auto byEndpoints = [](const auto& edgeOf) {
+        return [&edgeOf](int a, int b) {
+            const auto& x = edgeOf(a);
+            const auto& y = edgeOf(b);
+            if (x.source != y.source) return x.source < y.source;
+            if (x.target != y.target) return x.target < y.target;
+            return x.weight < y.weight;
+        };
+    };
+    auto fileEdge = [&fileArcs](int id) -> const Arc& { return fileArcs[id]; };
+    auto graphEdge = [&graph](int id) -> const GraphModel::Edge& { return graph.edge(id); };
+    std::vector<int> fileOrder(m), graphOrder(m);
+    std::iota(fileOrder.begin(), fileOrder.end(), 0);
+    std::iota(graphOrder.begin(), graphOrder.end(), 0);
+    std::sort(fileOrder.begin(), fileOrder.end(), byEndpoints(fileEdge));
+    std::sort(graphOrder.begin(), graphOrder.end(), byEndpoints(graphEdge));
+
+    std::vector<int> toGraph(arcCount);
+    for (quint64 i = 0; i < m; ++i) {
+        const Arc& a = fileArcs[fileOrder[i]];
+        const GraphModel::Edge& e = graph.edge(graphOrder[i]);
+        if (a.source != e.source || a.target != e.target || a.weight != e.weight) {
+            return fail(error, fileName + " is out of date");
+        }
+        toGraph[fileOrder[i]] = graphOrder[i];
+    }
+    for (quint64 id = m; id < arcCount; ++id) toGraph[id] = int(id);
+
+    arcs.assign(arcCount, Arc{});
+    for (quint64 id = 0; id < arcCount; ++id) {
+        Arc a = fileArcs[id];
+        if (a.first >= 0) {
+            a.first = toGraph[a.first];
+            a.second = toGraph[a.second];
+        }
+        arcs[toGraph[id]] = a;
+    }
+    rank = std::move(fileRank);
+    originalEdges = int(m);
+    buildSearchGraphs();
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include <QString>
+
+#include <atomic>
+#include <vector>
+
+#include "GraphModel.h"
+
+// Contraction hierarchy over a GraphModel snapshot.
+//
+// Nodes are contracted one at a time in order of edge difference
+// (shortcuts added minus edges removed, plus contracted neighbours).
+// Contracting v adds a shortcut u->x for every path u->v->x that has no
+// witness path avoiding v; the witness searches of one contraction run
+// on the thread pool. Afterwards every shortest path can be found by a
+// search that only climbs in rank from both ends (see
+// ShortestPathEngine::hierarchy).
+//
+// Arcs 0..edgeCount-1 are the original edges with their GraphModel ids;
+// later arcs are shortcuts that unpack into two lower arcs. Weights must
+// be non-negative.
+class ContractionHierarchy {
+public:
+    struct Arc {
+        int source;
+        int target;
+        double weight;
+        int first = -1;     // shortcut halves, -1 for original edges
+        int second = -1;
+    };
+
+    ContractionHierarchy() = default;
+    // Returns an empty hierarchy (nodeCount() == 0) if canceled.
+    explicit ContractionHierarchy(const GraphModel& graph, const std::atomic<bool>* cancel = nullptr);
+
+    int nodeCount() const { return int(rank.size()); }
+    int edgeCount() const { return originalEdges; }
+    int shortcutCount() const { return int(arcs.size()) - originalEdges; }
+    int nodeRank(int node) const { return rank[node]; }
+
+    // Arcs towards higher-ranked nodes, by source
+    int upBegin(int u) const { return upOffsets[u]; }
+    int upEnd(int u) const { return upOffsets[u + 1]; }
+    int upTarget(int slot) const { return upTargets[slot]; }
+    double upWeight(int slot) const { return upWeights[slot]; }
+    int upArc(int slot) const { return upArcs[slot]; }
+
+    // Arcs from higher-ranked nodes, by target (for the backward search)
+    int downBegin(int v) const { return downOffsets[v]; }
+    int downEnd(int v) const { return downOffsets[v + 1]; }
+    int downSource(int slot) const { return downSources[slot]; }
+    double downWeight(int slot) const { return downWeights[slot]; }
+    int downArc(int slot) const { return downArcs[slot]; }
+
+    const Arc& arc(int id) const { return arcs[id]; }
+    // Appends the original edge ids that arc stands for, in path order.
+    void unpack(int arcId, std::vector<int>& edges) const;
+
+    // Sidecar file stored next to a graph file
+    static QString sidecarPath(const QString& graphFile) { return graphFile + ".ch"; }
+    bool save(const QString& fileName, QString* error = nullptr) const;
+    // Fails if the file does not describe graph. Edges are matched by
+    // endpoints and weight, so a file whose edge order changed on reload
+    // (binary files group edges by source) is still accepted.
+    bool load(const QString& fileName, const GraphModel& graph, QString* error = nullptr);
+
+private:
+    void buildSearchGraphs();
+
+    int originalEdges = 0;
+    std::vector<int> rank;
+    std::vector<Arc> arcs;
+
+    std::vector<int> upOffsets;
+    std::vector<int> upTargets;
+    std::vector<double> upWeights;
+    std::vector<int> upArcs;
+
+    std::vector<int> downOffsets;
+    std::vector<int> downSources;
+    std::vector<double> downWeights;
+    std::vector<int> downArcs;
+};
+
+#endif // CONTRACTIONHIERARCHY_H
@@ -0,0 +1,93 @@
+#include "DistanceMatrix.h"
+#include "GraphIO.h"
+#include "Parallel.h"
+#include "ShortestPath.h"
+#include "Trace.h"
+
+#include <QThread>
+
+#include <limits>
+
+bool DistanceMatrix::johnsonPotentials(const GraphModel& graph, std::vector<double>& potential)
+{
+    GV_TRACE_SCOPE("DistanceMatrix::johnsonPotentials");
+    const int n = graph.nodeCount();
+
+    // A virtual source with zero-weight edges to every node: all start at 0
+    potential.assign(n, 0);
+    for (int round = 0; round <= n; ++round) {
+        bool changed = false;
+        for (int u = 0; u < n; ++u) {
+            const double base = potential[u];
+            for (int slot = graph.outBegin(u); slot < graph.outEnd(u); ++slot) {
+                const int v = graph.target(slot);
+                if (base + graph.weight(slot) < potential[v]) {
+                    potential[v] = base + graph.weight(slot);
+                    changed = true;
+                }
+            }
+        }
+        if (!changed) return true;
+    }
+    // Still relaxing after n + 1 rounds (n nodes plus the virtual source)
+    return false;
+}
+
+DistanceTable DistanceMatrix::compute(const GraphModel& graph, const std::vector<int>& sources,
+                                      const std::vector<int>& targets, const std::atomic<bool>* cancel)
+{
+    GV_TRACE_SCOPE("DistanceMatrix::compute");
+    DistanceTable table;
+    table.sources = sources;
+    table.targets = targets;
+
+    std::vector<double> potential;
+    for (int id = 0; id < graph.edgeCount(); ++id) {
+        if (graph.edge(id).weight < 0) {
+            table.reweighted = true;
+            break;
+        }
+    }
+    if (table.reweighted && !johnsonPotentials(graph, potential)) {
+        table.negativeCycle = true;
+        return table;
+    }
+
+    table.values.assign(sources.size() * targets.size(), std::numeric_limits<double>::infinity());
+    const int rows = int(sources.size());
+    const int grain = qMax(1, rows / (QThread::idealThreadCount() * 4));
+    std::atomic<bool> stopped{false};
+    parallelFor(rows, [&](int begin, int end) {
+        ShortestPathEngine engine;
+        for (int row = begin; row < end; ++row) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                stopped = true;
+                return;
+            }
+            engine.oneToMany(graph, sources[row], targets, &table.values[size_t(row) * targets.size()],
+                             table.reweighted ? &potential : nullptr);
+        }
+    }, grain);
+    table.canceled = stopped;
+    return table;
+}
+
+QByteArray DistanceMatrix::toCsv(const DistanceTable& table, const QStringList& sourceNames, const QStringList& targetNames)
+{
+    QByteArray csv = "source\\target";
+    for (int column = 0; column < int(table.targets.size()); ++column) {
+        csv += ',' + GraphIO::csvField(column < targetNames.size() ? targetNames[column] : QString::number(table.targets[column]));
+    }
+    csv += '\n';
+
+    for (int row = 0; row < int(table.sources.size()); ++row) {
+        csv += GraphIO::csvField(row < sourceNames.size() ? sourceNames[row] : QString::number(table.sources[row]));
+        for (int column = 0; column < int(table.targets.size()); ++column) {
+            const double value = table.values.empty() ? std::numeric_limits<double>::infinity() : table.at(row, column);
+            csv += ',';
+            csv += value < std::numeric_limits<double>::infinity() ? QByteArray::number(value, 'g', 17) : QByteArray("inf");
+        }
+        csv += '\n';
+    }
+    return csv;
+}
@@ -0,0 +1,44 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include <QByteArray>
+#include <QStringList>
+
+#include <atomic>
+#include <vector>
+
+#include "GraphModel.h"
+
+struct DistanceTable {
+    std::vector<int> sources;
+    std::vector<int> targets;
+    std::vector<double> values;     // row-major, sources x targets; infinity if unreachable
+    bool reweighted = false;        // negative weights were handled with Johnson's potentials
+    bool negativeCycle = false;     // no values: some distances are unbounded
+    bool canceled = false;
+
+    double at(int row, int column) const { return values[size_t(row) * targets.size() + column]; }
+};
+
+// Many-to-many shortest distances.
+//
+// Each source runs one Dijkstra that stops once every target is settled.
+// Sources are spread over the global thread pool and every chunk keeps
+// its own ShortestPathEngine, so scratch arrays are allocated once per
+// worker rather than once per source. Graphs with negative edge weights
+// are reweighted first (Johnson): one Bellman-Ford pass from a virtual
+// source gives potentials p with w + p[u] - p[v] >= 0 on every edge.
+namespace DistanceMatrix {
+
+DistanceTable compute(const GraphModel& graph, const std::vector<int>& sources, const std::vector<int>& targets,
+                      const std::atomic<bool>* cancel = nullptr);
+
+// Potentials for Johnson reweighting; false if there is a negative cycle.
+bool johnsonPotentials(const GraphModel& graph, std::vector<double>& potential);
+
+// First row and column hold the node names; unreachable cells are "inf".
+QByteArray toCsv(const DistanceTable& table, const QStringList& sourceNames, const QStringList& targetNames);
+
+}
+
+#endif // DISTANCEMATRIX_H
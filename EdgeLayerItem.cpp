@@ -0,0 +1,397 @@
+#include "EdgeLayerItem.h"
+#include "Trace.h"
+
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QPainterPath>
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
+
+namespace {
+// Edges whose bounds cover more cells than this are tested on every paint
+// instead of being registered in each cell.
+const int kMaxCellSpan = 16;
+const qreal kLabelWidth = 40;
+const qreal kLabelHeight = 20;
+// The style table is compacted whenever it reaches twice its live size
+const int kMinStyleLimit = 16;
+
+// Edge pens are QPen(color, width) with an optional dash style; the key
+// covers those, and styleIndex() still compares the pens themselves
+quint64 styleKey(const QPen& pen)
+{
+    return (quint64(pen.color().rgba()) << 32) | (quint32(qRound(pen.widthF() * 64)) << 4) | quint32(pen.style());
+}
+
+qreal distanceToSegment(const QPointF& p, const QLineF& line)
+{
+    const QPointF a = line.p1();
+    const QPointF ab = line.p2() - a;
+    const qreal length2 = QPointF::dotProduct(ab, ab);
+    qreal t = length2 > 0 ? QPointF::dotProduct(p - a, ab) / length2 : 0;
+    t = qBound<qreal>(0, t, 1);
+    const QPointF d = p - (a + ab * t);
+    return std::hypot(d.x(), d.y());
+}
+}
+
+EdgeLayerItem::EdgeLayerItem() {
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    setAcceptedMouseButtons(Qt::NoButton);
+    setZValue(-1);
+}
+
+QRectF EdgeLayerItem::boundingRect() const
+{
+    return bounds;
+}
+
+bool EdgeLayerItem::contains(const QPointF &point) const
+{
+    return edgeAt(point) >= 0;
+}
+
+void EdgeLayerItem::clear()
+{
+    lines.clear();
+    arrows.clear();
+    labelAnchors.clear();
+    texts.clear();
+    styleOf.clear();
+    styles.clear();
+    styleIds.clear();
+    styleLimit = 0;
+    prepareGeometryChange();
+    bounds = QRectF();
+    gridDirty = true;
+}
+
+void EdgeLayerItem::reserve(int edgeCount)
+{
+    lines.reserve(edgeCount);
+    arrows.reserve(size_t(edgeCount) * 3);
+    labelAnchors.reserve(edgeCount);
+    texts.reserve(edgeCount);
+    styleOf.reserve(edgeCount);
+}
+
+int EdgeLayerItem::styleIndex(const QPen &pen)
+{
+    const quint64 key = styleKey(pen);
+    const auto it = styleIds.constFind(key);
+    if (it != styleIds.constEnd() && styles[it.value()] == pen) return it.value();
+
+    // Highlighting keeps bringing in pens; drop the ones no edge uses any
+    // more before the table grows past twice its live size
+    if (styles.size() >= styleLimit) {
+        compactStyles();
+        styleLimit = qMax(kMinStyleLimit, 2 * int(styles.size()));
+    }
+    styles.append(pen);
+    styleIds.insert(key, styles.size() - 1);
+    return styles.size() - 1;
+}
+
+void EdgeLayerItem::compactStyles()
+{
+    std::vector<int> remap(styles.size(), -1);
+    for (quint16 style : styleOf) remap[style] = 0;
+
+    QVector<QPen> live;
+    styleIds.clear();
+    for (int s = 0; s < styles.size(); ++s) {
+        if (remap[s] < 0) continue;
+        remap[s] = live.size();
+        styleIds.insert(styleKey(styles[s]), live.size());
+        live.append(styles[s]);
+    }
+    for (quint16& style : styleOf) style = quint16(remap[style]);
+    styles = live;
+}
+
+QRectF EdgeLayerItem::edgeBounds(int id) const
+{
+    const QPointF* arrow = &arrows[size_t(id) * 3];
+    qreal left = qMin(lines[id].x1(), lines[id].x2());
+    qreal right = qMax(lines[id].x1(), lines[id].x2());
+    qreal top = qMin(lines[id].y1(), lines[id].y2());
+    qreal bottom = qMax(lines[id].y1(), lines[id].y2());
+    for (int k = 0; k < 3; ++k) {
+        left = qMin(left, arrow[k].x());
+        right = qMax(right, arrow[k].x());
+        top = qMin(top, arrow[k].y());
+        bottom = qMax(bottom, arrow[k].y());
+    }
+    const QPointF& anchor = labelAnchors[id];
+    right = qMax(right, anchor.x() + kLabelWidth);
+    bottom = qMax(bottom, anchor.y() + kLabelHeight);
+    const qreal margin = styles[styleOf[id]].widthF() + 1;
+    return QRectF(left - margin, top - margin, right - left + 2 * margin, bottom - top + 2 * margin);
+}
+
+void EdgeLayerItem::growBounds(const QRectF &rect)
+{
+    if (bounds.contains(rect)) return;
+    prepareGeometryChange();
+    bounds = bounds.isNull() ? rect : bounds.united(rect);
+}
+
+void EdgeLayerItem::markLoose(int id)
+{
+    if (gridDirty) return;
+    if (int(isLoose.size()) <= id) isLoose.resize(id + 1, 0);
+    if (!isLoose[id]) {
+        isLoose[id] = 1;
+        looseEdges.push_back(id);
+    }
+    // Past a point a rebuild is cheaper than testing the list every frame
+    if (looseEdges.size() > lines.size() / 8 + 64) gridDirty = true;
+}
+
+void EdgeLayerItem::addEdge(const QLineF &line, const QPolygonF &arrowHead, const QPointF &labelPos,
+                            const QString &text, const QPen &pen)
+{
+    const int id = int(lines.size());
+    lines.push_back(line);
+    for (int k = 0; k < 3; ++k) {
+        arrows.push_back(k < arrowHead.size() ? arrowHead[k] : line.p2());
+    }
+    labelAnchors.push_back(labelPos);
+    texts.push_back(text);
+    styleOf.push_back(quint16(styleIndex(pen)));
+
+    const QRectF rect = edgeBounds(id);
+    growBounds(rect);
+    markLoose(id);
+    update(rect);
+}
+
+void EdgeLayerItem::removeEdge(int id)
+{
+    update(edgeBounds(id));
+
+    const int last = int(lines.size()) - 1;
+    if (id != last) {
+        lines[id] = lines[last];
+        std::copy(arrows.begin() + size_t(last) * 3, arrows.begin() + size_t(last) * 3 + 3, arrows.begin() + size_t(id) * 3);
+        labelAnchors[id] = labelAnchors[last];
+        texts[id] = texts[last];
+        styleOf[id] = styleOf[last];
+    }
+    lines.pop_back();
+    arrows.resize(arrows.size() - 3);
+    labelAnchors.pop_back();
+    texts.pop_back();
+    styleOf.pop_back();
+
+    // The grid still lists the removed edge under `id` and the moved one
+    // under its old id, which is now past the end and skipped. Marking
+    // `id` loose hides the stale entries and tests the moved edge directly.
+    if (id != last) markLoose(id);
+}
+
+void EdgeLayerItem::setEdgeGeometry(int id, const QLineF &line, const QPolygonF &arrowHead, const QPointF &labelPos)
+{
+    update(edgeBounds(id));
+
+    lines[id] = line;
+    for (int k = 0; k < 3; ++k) {
+        arrows[size_t(id) * 3 + k] = k < arrowHead.size() ? arrowHead[k] : line.p2();
+    }
+    labelAnchors[id] = labelPos;
+
+    const QRectF rect = edgeBounds(id);
+    growBounds(rect);
+    markLoose(id);
+    update(rect);
+}
+
+void EdgeLayerItem::setEdgeStyle(int id, const QPen &pen)
+{
+    const quint16 style = quint16(styleIndex(pen));
+    if (styleOf[id] == style) return;
+    styleOf[id] = style;
+    update(edgeBounds(id));
+}
+
+void EdgeLayerItem::setEdgeText(int id, const QString &text)
+{
+    texts[id] = text;
+    update(edgeBounds(id));
+}
+
+void EdgeLayerItem::setDetail(const Detail &levels)
+{
+    detail = levels;
+    update();
+}
+
+void EdgeLayerItem::ensureGrid() const
+{
+    if (!gridDirty) return;
+
+    const int m = int(lines.size());
+    gridRect = bounds;
+    const qreal area = qMax<qreal>(gridRect.width() * gridRect.height(), 1);
+    const qreal targetCells = qBound<qreal>(1, m / 2.0, 1 << 20);
+    cellSize = qMax<qreal>(std::sqrt(area / targetCells), 8);
+    columns = qMax(1, int(std::ceil(gridRect.width() / cellSize)));
+    rows = qMax(1, int(std::ceil(gridRect.height() / cellSize)));
+
+    auto cellRange = [this](const QRectF& r, int& c0, int& r0, int& c1, int& r1) {
+        c0 = qBound(0, int((r.left() - gridRect.left()) / cellSize), columns - 1);
+        c1 = qBound(0, int((r.right() - gridRect.left()) / cellSize), columns - 1);
+        r0 = qBound(0, int((r.top() - gridRect.top()) / cellSize), rows - 1);
+        r1 = qBound(0, int((r.bottom() - gridRect.top()) / cellSize), rows - 1);
+    };
+
+    // Two passes over the edges: count per cell, then fill
+    cellStart.assign(size_t(columns) * rows + 1, 0);
+    wideEdges.clear();
+    std::vector<char> wide(m, 0);
+    for (int id = 0; id < m; ++id) {
+        int c0, r0, c1, r1;
+        cellRange(edgeBounds(id), c0, r0, c1, r1);
+        if ((c1 - c0 + 1) * (r1 - r0 + 1) > kMaxCellSpan) {
+            wide[id] = 1;
+            wideEdges.push_back(id);
+            continue;
+        }
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                cellStart[size_t(r) * columns + c + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+
+    cellEdges.resize(cellStart.back());
+    std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (int id = 0; id < m; ++id) {
+        if (wide[id]) continue;
+        int c0, r0, c1, r1;
+        cellRange(edgeBounds(id), c0, r0, c1, r1);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                cellEdges[cursor[size_t(r) * columns + c]++] = id;
+    }
+
+    looseEdges.clear();
+    isLoose.assign(m, 0);
+    gridDirty = false;
+}
+
+template <typename Visit>
+void EdgeLayerItem::forEachCandidate(const QRectF &rect, Visit visit) const
+{
+    ensureGrid();
+
+    const int m = int(lines.size());
+    if (int(seen.size()) < m) seen.resize(m, 0);
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+
+    // Ids past the end are left over from removals since the last rebuild
+    auto test = [&](int id) {
+        if (id >= m || seen[id] == stamp) return;
+        seen[id] = stamp;
+        if (edgeBounds(id).intersects(rect)) visit(id);
+    };
+
+    if (columns > 0 && rect.intersects(gridRect)) {
+        const int c0 = qBound(0, int((rect.left() - gridRect.left()) / cellSize), columns - 1);
+        const int c1 = qBound(0, int((rect.right() - gridRect.left()) / cellSize), columns - 1);
+        const int r0 = qBound(0, int((rect.top() - gridRect.top()) / cellSize), rows - 1);
+        const int r1 = qBound(0, int((rect.bottom() - gridRect.top()) / cellSize), rows - 1);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                const size_t cell = size_t(r) * columns + c;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    const int id = cellEdges[k];
+                    if (id >= m || !isLoose[id]) test(id);
+                }
+            }
+        }
+    }
+    for (int id : wideEdges) {
+        if (id >= m || !isLoose[id]) test(id);
+    }
+    for (int id : looseEdges) {
+        test(id);
+    }
+}
+
+int EdgeLayerItem::edgeAt(const QPointF &point, qreal tolerance) const
+{
+    int best = -1;
+    qreal bestDistance = 0;
+    QRectF probe(point.x() - tolerance, point.y() - tolerance, 2 * tolerance, 2 * tolerance);
+    forEachCandidate(probe, [&](int id) {
+        const qreal d = distanceToSegment(point, lines[id]);
+        if (d <= tolerance + styles[styleOf[id]].widthF() / 2 && (best < 0 || d < bestDistance)) {
+            best = id;
+            bestDistance = d;
+        }
+    });
+    return best;
+}
+
+void EdgeLayerItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    GV_TRACE_SCOPE("EdgeLayerItem::paint");
+    const qreal lod = detail.enabled ? QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) : 1.0;
+
+    batchLines.resize(styles.size());
+    batchEdges.resize(styles.size());
+    for (int s = 0; s < styles.size(); ++s) {
+        batchLines[s].clear();
+        batchEdges[s].clear();
+    }
+
+    int visible = 0;
+    forEachCandidate(option->exposedRect, [&](int id) {
+        batchLines[styleOf[id]].push_back(lines[id]);
+        batchEdges[styleOf[id]].push_back(id);
+        ++visible;
+    });
+    if (paintCounter) *paintCounter += visible;
+
+    // One drawLines() per pen
+    for (int s = 0; s < styles.size(); ++s) {
+        if (batchLines[s].empty()) continue;
+        painter->setPen(lod < detail.points ? QPen(styles[s].color(), 0) : styles[s]);
+        painter->drawLines(batchLines[s].data(), int(batchLines[s].size()));
+    }
+
+    // One path per pen for the arrowheads. They all wind the same way, so
+    // overlapping heads stay filled under the winding rule.
+    if (lod >= detail.arrows) {
+        for (int s = 0; s < styles.size(); ++s) {
+            if (batchEdges[s].empty()) continue;
+            QPainterPath heads;
+            heads.setFillRule(Qt::WindingFill);
+            for (int id : batchEdges[s]) {
+                const QPointF* arrow = &arrows[size_t(id) * 3];
+                heads.moveTo(arrow[0]);
+                heads.lineTo(arrow[1]);
+                heads.lineTo(arrow[2]);
+                heads.closeSubpath();
+            }
+            painter->setPen(styles[s]);
+            painter->setBrush(styles[s].color());
+            painter->drawPath(heads);
+        }
+    }
+
+    if (lod >= detail.labels) {
+        painter->setPen(Qt::black);
+        // Match the placement of a QGraphicsTextItem (4px document margin)
+        const QPointF offset(4, 4 + QFontMetricsF(painter->font()).ascent());
+        for (int s = 0; s < styles.size(); ++s) {
+            for (int id : batchEdges[s]) {
+                painter->drawText(labelAnchors[id] + offset, texts[id]);
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef EDGELAYERITEM_H
+#define EDGELAYERITEM_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPen>
+#include <QVector>
+
+#include <vector>
+
+// Draws every edge of the scene from one item.
+//
+// Segments, arrowheads, label anchors and a per-edge style index are kept
+// in contiguous arrays indexed by edge id (the same ids as GraphScene's
+// registry, including swap-and-pop on removal). Painting culls against the
+// exposed rect through a uniform grid and issues one drawLines() call and
+// one arrowhead path per pen, so per-item scene overhead no longer grows
+// with the edge count. Pens are shared through a small style table.
+// Edges whose geometry or id changed since the grid was built are kept on a
+// short "loose" list and tested directly until the next rebuild.
+//
+// The item does not know about the scene: level-of-detail thresholds and
+// the painted-items counter are handed in by GraphScene.
+class EdgeLayerItem : public QGraphicsItem {
+public:
+    // Same meaning as the lod* fields of staticInformation
+    struct Detail {
+        bool enabled = true;
+        qreal labels = 0;
+        qreal arrows = 0;
+        qreal points = 0;
+    };
+
+    EdgeLayerItem();
+
+    QRectF boundingRect() const override;
+    bool contains(const QPointF& point) const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+    void clear();
+    void reserve(int edgeCount);
+    void addEdge(const QLineF& line, const QPolygonF& arrowHead, const QPointF& labelPos,
+                 const QString& text, const QPen& pen);
+    void removeEdge(int id);
+    void setEdgeGeometry(int id, const QLineF& line, const QPolygonF& arrowHead, const QPointF& labelPos);
+    void setEdgeStyle(int id, const QPen& pen);
+    void setEdgeText(int id, const QString& text);
+
+    void setDetail(const Detail& levels);
+    // Incremented by the number of edges drawn in each paint
+    void setPaintCounter(int* counter) { paintCounter = counter; }
+
+    int edgeCount() const { return int(lines.size()); }
+
+    // Edge whose segment passes within `tolerance` of the point, or -1.
+    int edgeAt(const QPointF& point, qreal tolerance = 4) const;
+
+private:
+    int styleIndex(const QPen& pen);
+    void compactStyles();
+    void growBounds(const QRectF& rect);
+    QRectF edgeBounds(int id) const;
+    void markLoose(int id);
+    void ensureGrid() const;
+    template <typename Visit> void forEachCandidate(const QRectF& rect, Visit visit) const;
+
+    std::vector<QLineF> lines;
+    std::vector<QPointF> arrows;        // three points per edge
+    std::vector<QPointF> labelAnchors;
+    std::vector<QString> texts;
+    std::vector<quint16> styleOf;
+    QVector<QPen> styles;
+    QHash<quint64, int> styleIds;   // see styleKey() in the .cpp
+    int styleLimit = 0;
+    QRectF bounds;
+    Detail detail;
+    int* paintCounter = nullptr;
+
+    // Spatial grid in CSR form: edges of cell c are cellEdges[cellStart[c] .. cellStart[c+1])
+    mutable bool gridDirty = true;
+    mutable QRectF gridRect;
+    mutable qreal cellSize = 1;
+    mutable int columns = 0;
+    mutable int rows = 0;
+    mutable std::vector<int> cellStart;
+    mutable std::vector<int> cellEdges;
+    mutable std::vector<int> wideEdges;   // span too many cells to register
+    mutable std::vector<int> looseEdges;
+    mutable std::vector<char> isLoose;
+
+    // Per-paint scratch, kept to avoid reallocating every frame
+    mutable std::vector<unsigned> seen;
+    mutable unsigned stamp = 0;
+    mutable std::vector<std::vector<QLineF>> batchLines;
+    mutable std::vector<std::vector<int>> batchEdges;
+};
+
+#endif // EDGELAYERITEM_H
@@ -0,0 +1,245 @@
+#include "ForceLayout.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const int kLeafSize = 4;
+const int kMaxDepth = 32;
+// Keeps coincident nodes from producing infinite forces
+const double kMinDistance = 0.01;
+}
+
+ForceLayout::ForceLayout(const GraphModel& graph, const Settings& settings)
+    : graph(graph), settings(settings) {
+    const int n = graph.nodeCount();
+    posX.resize(n);
+    posY.resize(n);
+    dispX.resize(n);
+    dispY.resize(n);
+    for (int u = 0; u < n; ++u) {
+        posX[u] = graph.x(u);
+        posY[u] = graph.y(u);
+    }
+    seedPositions();
+    startTemperature = settings.idealLength * std::sqrt(double(std::max(n, 1))) / 4;
+    temperature = startTemperature;
+}
+
+void ForceLayout::seedPositions()
+{
+    const int n = graph.nodeCount();
+    if (n < 2) return;
+
+    auto [minX, maxX] = std::minmax_element(posX.begin(), posX.end());
+    auto [minY, maxY] = std::minmax_element(posY.begin(), posY.end());
+    const double extent = std::max(*maxX - *minX, *maxY - *minY);
+    const double spacing = settings.idealLength;
+    if (extent >= spacing * std::sqrt(double(n)) / 4) return;
+
+    // Imported graphs often carry no coordinates at all. Start from a
+    // sunflower spiral filled in breadth-first order (ignoring edge
+    // direction), so neighbours begin close together and the layout does
+    // not have to untangle a random permutation.
+    std::vector<int> degree(n + 1, 0);
+    for (int id = 0; id < graph.edgeCount(); ++id) {
+        degree[graph.edge(id).source + 1]++;
+        degree[graph.edge(id).target + 1]++;
+    }
+    for (int u = 0; u < n; ++u) degree[u + 1] += degree[u];
+    std::vector<int> adjacent(degree[n]);
+    std::vector<int> cursor(degree.begin(), degree.end() - 1);
+    for (int id = 0; id < graph.edgeCount(); ++id) {
+        const GraphModel::Edge& e = graph.edge(id);
+        adjacent[cursor[e.source]++] = e.target;
+        adjacent[cursor[e.target]++] = e.source;
+    }
+
+    std::vector<int> visitOrder;
+    visitOrder.reserve(n);
+    std::vector<char> visited(n, 0);
+    for (int root = 0; root < n; ++root) {
+        if (visited[root]) continue;
+        visited[root] = 1;
+        visitOrder.push_back(root);
+        for (size_t head = visitOrder.size() - 1; head < visitOrder.size(); ++head) {
+            const int u = visitOrder[head];
+            for (int k = degree[u]; k < degree[u + 1]; ++k) {
+                if (!visited[adjacent[k]]) {
+                    visited[adjacent[k]] = 1;
+                    visitOrder.push_back(adjacent[k]);
+                }
+            }
+        }
+    }
+
+    const double golden = M_PI * (3 - std::sqrt(5.0));
+    const double cx = *minX;
+    const double cy = *minY;
+    for (int i = 0; i < n; ++i) {
+        double r = spacing * std::sqrt(i + 0.5);
+        posX[visitOrder[i]] = cx + r * std::cos(i * golden);
+        posY[visitOrder[i]] = cy + r * std::sin(i * golden);
+    }
+}
+
+void ForceLayout::buildCell(int index, int begin, int end, double x0, double y0, double size, int depth)
+{
+    double sx = 0, sy = 0;
+    for (int k = begin; k < end; ++k) {
+        sx += posX[order[k]];
+        sy += posY[order[k]];
+    }
+    cells[index] = Cell{sx / (end - begin), sy / (end - begin), double(end - begin), size, -1, begin, end};
+
+    if (end - begin <= kLeafSize || depth >= kMaxDepth) return;
+
+    // Split into quadrants: first by y, then each half by x
+    const double half = size / 2;
+    const double midX = x0 + half;
+    const double midY = y0 + half;
+    auto first = order.begin();
+    auto above = [&](int u) { return posY[u] < midY; };
+    auto left = [&](int u) { return posX[u] < midX; };
+    const int splitY = int(std::partition(first + begin, first + end, above) - first);
+    const int splitTop = int(std::partition(first + begin, first + splitY, left) - first);
+    const int splitBottom = int(std::partition(first + splitY, first + end, left) - first);
+
+    const int ranges[4][2] = {{begin, splitTop}, {splitTop, splitY}, {splitY, splitBottom}, {splitBottom, end}};
+    const double corners[4][2] = {{x0, y0}, {midX, y0}, {x0, midY}, {midX, midY}};
+
+    // Children are stored consecutively; empty quadrants stay massless leaves
+    const int firstChild = int(cells.size());
+    cells[index].firstChild = firstChild;
+    cells.resize(cells.size() + 4, Cell{0, 0, 0, half, -1, 0, 0});
+    for (int q = 0; q < 4; ++q) {
+        if (ranges[q][0] == ranges[q][1]) continue;
+        buildCell(firstChild + q, ranges[q][0], ranges[q][1], corners[q][0], corners[q][1], half, depth + 1);
+    }
+}
+
+void ForceLayout::buildTree()
+{
+    const int n = graph.nodeCount();
+    order.resize(n);
+    for (int u = 0; u < n; ++u) order[u] = u;
+
+    auto [minX, maxX] = std::minmax_element(posX.begin(), posX.end());
+    auto [minY, maxY] = std::minmax_element(posY.begin(), posY.end());
+    const double size = std::max({*maxX - *minX, *maxY - *minY, kMinDistance}) * (1 + 1e-9);
+
+    cells.clear();
+    cells.reserve(size_t(n) * 2);
+    cells.resize(1);
+    buildCell(0, 0, n, *minX, *minY, size, 0);
+}
+
+void ForceLayout::repulsion(int node, double& fx, double& fy) const
+{
+    const double k2 = settings.idealLength * settings.idealLength;
+    const double theta2 = settings.theta * settings.theta;
+    const double x = posX[node];
+    const double y = posY[node];
+
+    int stack[4 * kMaxDepth + 4];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Cell& cell = cells[stack[--top]];
+        if (cell.mass == 0) continue;
+
+        if (cell.firstChild < 0) {
+            for (int k = cell.begin; k < cell.end; ++k) {
+                const int other = order[k];
+                if (other == node) continue;
+                double dx = x - posX[other];
+                double dy = y - posY[other];
+                double d2 = dx * dx + dy * dy;
+                if (d2 < kMinDistance * kMinDistance) {
+                    // Push coincident nodes apart in an id-dependent direction
+                    dx = node < other ? kMinDistance : -kMinDistance;
+                    dy = 0;
+                    d2 = kMinDistance * kMinDistance;
+                }
+                fx += dx * k2 / d2;
+                fy += dy * k2 / d2;
+            }
+            continue;
+        }
+
+        double dx = x - cell.cx;
+        double dy = y - cell.cy;
+        double d2 = dx * dx + dy * dy;
+        if (cell.size * cell.size < theta2 * d2) {
+            fx += dx * cell.mass * k2 / d2;
+            fy += dy * cell.mass * k2 / d2;
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) stack[top++] = cell.firstChild + q;
+    }
+}
+
+void ForceLayout::step()
+{
+    GV_TRACE_SCOPE("ForceLayout::step");
+    const int n = graph.nodeCount();
+    if (n == 0 || done()) {
+        iteration = settings.iterations;
+        return;
+    }
+
+    buildTree();
+
+    double cx = 0, cy = 0;
+    for (int u = 0; u < n; ++u) {
+        cx += posX[u];
+        cy += posY[u];
+    }
+    cx /= n;
+    cy /= n;
+
+    const double gravity = settings.gravity;
+    parallelFor(n, [&](int begin, int end) {
+        for (int u = begin; u < end; ++u) {
+            double fx = 0, fy = 0;
+            repulsion(u, fx, fy);
+            dispX[u] = fx - gravity * (posX[u] - cx);
+            dispY[u] = fy - gravity * (posY[u] - cy);
+        }
+    }, 1024);
+
+    // Attraction d^2/k along each edge, applied to both endpoints
+    const double k = settings.idealLength;
+    for (int id = 0; id < graph.edgeCount(); ++id) {
+        const GraphModel::Edge& e = graph.edge(id);
+        if (e.source == e.target) continue;
+        double dx = posX[e.source] - posX[e.target];
+        double dy = posY[e.source] - posY[e.target];
+        double d = std::max(std::hypot(dx, dy), kMinDistance);
+        double f = d / k;
+        dispX[e.source] -= dx * f;
+        dispY[e.source] -= dy * f;
+        dispX[e.target] += dx * f;
+        dispY[e.target] += dy * f;
+    }
+
+    // Move each node along its force, at most `temperature` far
+    const double limit = temperature;
+    parallelFor(n, [&](int begin, int end) {
+        for (int u = begin; u < end; ++u) {
+            double length = std::hypot(dispX[u], dispY[u]);
+            if (length <= 0) continue;
+            double scale = std::min(length, limit) / length;
+            posX[u] += dispX[u] * scale;
+            posY[u] += dispY[u] * scale;
+        }
+    });
+
+    ++iteration;
+    // Linear cooling, with a floor so the last steps still settle
+    temperature = std::max(startTemperature * (1 - double(iteration) / settings.iterations), settings.idealLength / 50);
+}
@@ -0,0 +1,63 @@
+#ifndef FORCELAYOUT_H
+#define FORCELAYOUT_H
+
+#include <vector>
+
+#include "GraphModel.h"
+
+// Fruchterman-Reingold layout over flat coordinate arrays.
+//
+// Repulsion is approximated with a Barnes-Hut quadtree that is rebuilt
+// every iteration; a cell whose size/distance ratio is below `theta` acts
+// as a single body at its center of mass, so one step costs
+// O(n log n + m) instead of O(n^2). The per-node force pass runs on the
+// global thread pool. Edges attract in both directions. Coordinates use
+// the GraphModel convention (node rect top-left).
+class ForceLayout {
+public:
+    struct Settings {
+        int iterations = 300;
+        double idealLength = 80;    // preferred edge length in scene units
+        double theta = 0.9;         // Barnes-Hut opening criterion
+        double gravity = 1.0;       // linear pull towards the centroid, keeps components together
+    };
+
+    ForceLayout(const GraphModel& graph, const Settings& settings);
+
+    void step();
+    bool done() const { return iteration >= settings.iterations; }
+    int iterationCount() const { return iteration; }
+
+    const std::vector<double>& xs() const { return posX; }
+    const std::vector<double>& ys() const { return posY; }
+
+private:
+    struct Cell {
+        double cx, cy;        // center of mass
+        double mass;
+        double size;          // side length of the square
+        int firstChild;       // four consecutive children, or -1 for a leaf
+        int begin, end;       // bodies of a leaf in `order`
+    };
+
+    void seedPositions();
+    void buildTree();
+    void buildCell(int index, int begin, int end, double x0, double y0, double size, int depth);
+    void repulsion(int node, double& fx, double& fy) const;
+
+    const GraphModel& graph;
+    Settings settings;
+    int iteration = 0;
+    double startTemperature = 0;
+    double temperature = 0;
+
+    std::vector<double> posX;
+    std::vector<double> posY;
+    std::vector<double> dispX;
+    std::vector<double> dispY;
+
+    std::vector<Cell> cells;
+    std::vector<int> order;
+};
+
+#endif // FORCELAYOUT_H
@@ -1,207 +1,678 @@
 #include "Graph.h"
+#include "Parallel.h"
+#include "ImageExport.h"
 
+static const char* kGraphFileFilter = "Graph files (*.json *.gvb);;JSON (*.json);;Binary (*.gvb)";
 
-GraphScene::GraphScene(StateMouse *state, QObject *parent) : QGraphicsScene(parent), stateMouse(state), tempEdge(nullptr), startNode(nullptr) {
+// Node plus edge count up to which GraphScene::removeNodes() takes items
+// out one at a time instead of rebuilding the survivors
+static const int kItemwiseRemovalLimit = 64;
+
+
+static EdgeLayerItem::Detail edgeLayerDetail()
+{
+    auto info = staticInformation::instance();
+    EdgeLayerItem::Detail detail;
+    detail.enabled = info->lodEnabled;
+    detail.labels = info->lodLabels;
+    detail.arrows = info->lodArrows;
+    detail.points = info->lodPoints;
+    return detail;
+}
+
+static QHash<QString, QStaticText>& staticLabels()
+{
+    static QHash<QString, QStaticText> cache;
+    return cache;
+}
+
+QStaticText StaticLabelCache::get(const QString &text)
+{
+    QHash<QString, QStaticText>& cache = staticLabels();
+    auto it = cache.find(text);
+    if (it == cache.end()) {
+        QStaticText label(text);
+        label.setTextFormat(Qt::PlainText);
+        label.prepare(QTransform(), QFont());
+        it = cache.insert(text, label);
+    }
+    return it.value();
+}
+
+void StaticLabelCache::clear()
+{
+    staticLabels().clear();
+}
+
+QRectF StaticLabelCache::rect(const QPointF &anchor, const QStaticText &text)
+{
+    // QGraphicsTextItem puts a 4px document margin around the text
+    const QSizeF size = text.size();
+    return QRectF(anchor, QSizeF(size.width() + 8, size.height() + 8));
+}
+
+void StaticLabelCache::paint(QPainter *painter, const QPointF &anchor, const QStaticText &text)
+{
+    painter->setPen(Qt::black);
+    painter->drawStaticText(anchor + QPointF(4, 4), text);
+}
+
+QVariant NodeItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemPositionHasChanged) {
+        scene_Pos = pos() + rect().topLeft();
+        if (GraphScene* graphScene = qobject_cast<GraphScene*>(scene())) {
+            graphScene->nodeMoved(this);
+        }
+    }
+    return QGraphicsEllipseItem::itemChange(change, value);
+}
+
+void NodeItem::addEdge(EdgeItem *edge)
+{
+    // Listed already: a second entry would outlive the edge once the
+    // first one removes it
+    if (edge->slotIn(this) >= 0) return;
+    edge->slotIn(this) = connectedEdges.size();
+    connectedEdges.append(edge);
+}
+
+void NodeItem::removeEdge(EdgeItem *edge)
+{
+    int& slot = edge->slotIn(this);
+    if (slot < 0) return;
+    EdgeItem* last = connectedEdges.takeLast();
+    if (last != edge) {
+        connectedEdges[slot] = last;
+        last->slotIn(this) = slot;
+    }
+    slot = -1;
+}
+
+GraphScene::GraphScene(StateMouse *state, QObject *parent) : QGraphicsScene(parent), stateMouse(state), tempEdge(nullptr), startNode(nullptr),
+    grid(staticInformation::instance()->nodeR) {
 
 }
 
 void GraphScene::clearScene()
 {
-    QList<QGraphicsItem*> allItems = items();
-    for (QGraphicsItem* item : allItems) {
-        removeItem(item);
-        delete item;
+    GV_TRACE_SCOPE("GraphScene::clearScene");
+    // One pass: edges forget their endpoints, which go too, and
+    // QGraphicsScene::clear() drops its index once and deletes every
+    // top-level item. Removing them one by one costs a linear search of
+    // the scene's item list each.
+    if (edgeLayer) {
+        removeItem(edgeLayer);
+        edgeLayer->clear();
+    }
+    for (EdgeItem* edge : std::as_const(edgeItems)) {
+        edge->start = nullptr;
+        edge->end = nullptr;
+        // With the edge layer enabled edges are not in the scene at all
+        if (edge->scene() != this) delete edge;
     }
+    QGraphicsScene::clear();
+    tempEdge = nullptr;
+    startNode = nullptr;
+    nodeItems.clear();
+    edgeItems.clear();
+    labels.clear();
+    StaticLabelCache::clear();
+    grid.clear(staticInformation::instance()->nodeR);
+    movedEdges.clear();
+    treeCache.clear();
+    if (edgeLayer) addItem(edgeLayer);
+    modelDirty = true;
+    ++revision;
 }
 
 void GraphScene::setNodesMoveAble(bool isMoveAble)
 {
-    auto itemsAtScene = items();
-    for (QGraphicsItem *item : itemsAtScene) {
-        auto node = dynamic_cast<NodeItem*>(item);
-        if (node) {
-            if(isMoveAble)
-            {
-                node->setFlag(QGraphicsItem::ItemIsMovable, true);
-                node->setFlag(QGraphicsItem::ItemIsSelectable, true);
-            }
-            else
-            {
-                node->setFlag(QGraphicsItem::ItemIsMovable, false);
-                node->setFlag(QGraphicsItem::ItemIsSelectable, false);
-            }
+    for (NodeItem *node : std::as_const(nodeItems)) {
+        if(isMoveAble)
+        {
+            node->setFlag(QGraphicsItem::ItemIsMovable, true);
+            node->setFlag(QGraphicsItem::ItemIsSelectable, true);
         }
+        else
+        {
+            node->setFlag(QGraphicsItem::ItemIsMovable, false);
+            node->setFlag(QGraphicsItem::ItemIsSelectable, false);
+        }
+    }
+}
+
+void GraphScene::addNode(NodeItem *node)
+{
+    node->id = nodeItems.size();
+    nodeItems.append(node);
+    labels.insert(node->label, node->id);
+    const qreal r = node->rect().width() / 2;
+    grid.insert(node->id, node->scene_Pos.x() + r, node->scene_Pos.y() + r, r);
+    addItem(node);
+    treeCache.nodeAdded();
+    modelDirty = true;
+    ++revision;
+}
+
+void GraphScene::addEdge(EdgeItem *edge)
+{
+    edge->id = edgeItems.size();
+    edgeItems.append(edge);
+    if (edgeLayer) {
+        attachToLayer(edge);
+    } else {
+        addItem(edge);
     }
+    treeCache.edgeAdded(edge->start->id, edge->end->id, edge->getWeight());
+    modelDirty = true;
+    ++revision;
 }
 
-void GraphScene::runDijkstra(NodeItem* start, NodeItem* end) {
-    QMap<NodeItem*, qreal> distances;
-    QMap<NodeItem*, NodeItem*> previous;
-    QSet<NodeItem*> visited;
-    QList<NodeItem*> nodes;
+void GraphScene::removeNode(NodeItem *node)
+{
+    // Each removal takes the edge out of this list by swapping in the last one
+    while (!node->connectedEdges.isEmpty()) {
+        removeEdge(node->connectedEdges.last());
+    }
+
+    labels.remove(node->label, node->id);
+    grid.remove(node->id);
+    treeCache.nodeRemoved(node->id, nodeItems.size() - 1);
+    NodeItem* last = nodeItems.takeLast();
+    if (last != node) {
+        labels.renumber(last->label, last->id, node->id);
+        nodeItems[node->id] = last;
+        last->id = node->id;
+    }
+    removeItem(node);
+    delete node;
+    modelDirty = true;
+    ++revision;
+}
 
-    for (QGraphicsItem* item : items()) {
-        auto node = dynamic_cast<NodeItem*>(item);
-        if (node) {
-            distances[node] = std::numeric_limits<qreal>::max();
-            nodes.append(node);
+void GraphScene::removeNodes(const QVector<NodeItem *> &nodes)
+{
+    GV_TRACE_SCOPE("GraphScene::removeNodes");
+    std::vector<char> nodeGone(nodeItems.size(), 0);
+    std::vector<char> edgeGone(edgeItems.size(), 0);
+    QVector<NodeItem*> doomed;
+    int doomedEdges = 0;
+    for (NodeItem* node : nodes) {
+        if (nodeGone[node->id]) continue;
+        nodeGone[node->id] = 1;
+        doomed.append(node);
+        for (EdgeItem* edge : std::as_const(node->connectedEdges)) {
+            if (!edgeGone[edge->id]) {
+                edgeGone[edge->id] = 1;
+                ++doomedEdges;
+            }
         }
     }
+    if (doomed.size() == nodeItems.size()) {
+        clearScene();
+        return;
+    }
 
-    distances[start] = 0;
+    // Every item QGraphicsScene takes out costs a linear search of its
+    // top-level and index lists, so removing k of N items one at a time
+    // is O(k*N). Only a handful go that way; a larger batch is one clear()
+    // and a bulk re-add of the survivors.
+    if (doomed.size() + doomedEdges <= kItemwiseRemovalLimit) {
+        for (NodeItem* node : std::as_const(doomed)) removeNode(node);
+        return;
+    }
 
-    while (!nodes.isEmpty()) {
-        std::sort(nodes.begin(), nodes.end(), [&](NodeItem* a, NodeItem* b) {
-            return distances[a] < distances[b];
-        });
+    rebuildItems(nodeGone, edgeGone);
+}
 
-        NodeItem* current = nodes.takeFirst();
-        if (current == end) break;
-        if (visited.contains(current)) continue;
+void GraphScene::rebuildItems(const std::vector<char> &nodeGone, const std::vector<char> &edgeGone)
+{
+    GV_TRACE_SCOPE("GraphScene::rebuildItems");
+    std::vector<int> newNodeId(nodeItems.size(), -1);
+    std::vector<int> newEdgeId(edgeItems.size(), -1);
+    int nodeCount = 0;
+    int edgeCount = 0;
+    for (int i = 0; i < nodeItems.size(); ++i) {
+        if (!nodeGone[i]) newNodeId[i] = nodeCount++;
+    }
+    for (int i = 0; i < edgeItems.size(); ++i) {
+        if (!edgeGone[i]) newEdgeId[i] = edgeCount++;
+    }
 
-        visited.insert(current);
+    // Replacements carry over position, size, pens, flags and selection
+    QVector<NodeItem*> keptNodes;
+    QVector<EdgeItem*> keptEdges;
+    std::vector<char> selected(nodeCount, 0);
+    keptNodes.reserve(nodeCount);
+    keptEdges.reserve(edgeCount);
+    for (NodeItem* old : std::as_const(nodeItems)) {
+        if (nodeGone[old->id]) continue;
+        const QRectF r = old->rect();
+        NodeItem* node = new NodeItem(r.x(), r.y(), r.width(), r.height(), old->label);
+        node->setPos(old->pos());
+        node->setBrush(old->brush());
+        node->setPen(old->pen());
+        node->setZValue(old->zValue());
+        node->setFlags(old->flags());
+        node->id = keptNodes.size();
+        selected[node->id] = old->isSelected();
+        keptNodes.append(node);
+    }
+    for (EdgeItem* old : std::as_const(edgeItems)) {
+        if (edgeGone[old->id]) continue;
+        EdgeItem* edge = new EdgeItem(keptNodes[newNodeId[old->start->id]], keptNodes[newNodeId[old->end->id]],
+                                      old->getWeight(), true);
+        edge->setGeometry(old->geometry());
+        edge->setPen(old->edgePen().color(), old->edgePen().width());
+        edge->id = keptEdges.size();
+        keptEdges.append(edge);
+    }
 
-        //qDebug() << current->labelItem->toPlainText();
-        for (EdgeItem* edge : current->connectedEdges) {
-            NodeItem* neighbor = (edge->start == current) ? edge->end : nullptr;
-            if(!neighbor) continue;
-            if (visited.contains(neighbor)) continue;
+    // clearScene() empties the tree cache and bumps the revision; the
+    // trees are remapped instead, and only a removal is a new topology
+    const bool removed = nodeCount < nodeItems.size() || edgeCount < edgeItems.size();
+    if (removed) treeCache.compact(newNodeId, newEdgeId);
+    PathTreeCache trees = std::move(treeCache);
+    const quint64 keptRevision = revision;
+    clearScene();
+    treeCache = std::move(trees);
+    revision = removed ? keptRevision + 1 : keptRevision;
+
+    const ItemIndexMethod indexMethod = itemIndexMethod();
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+    const QList<QGraphicsView*> attachedViews = views();
+    for (QGraphicsView* view : attachedViews) {
+        view->setUpdatesEnabled(false);
+    }
 
-            qreal alt = distances[current] + edge->getWeight();
-            if (alt < distances[neighbor]) {
-                distances[neighbor] = alt;
-                previous[neighbor] = current;
-            }
+    nodeItems = std::move(keptNodes);
+    edgeItems = std::move(keptEdges);
+    grid.reserve(nodeCount);
+    for (NodeItem* node : std::as_const(nodeItems)) {
+        labels.insert(node->label, node->id);
+        const qreal r = node->rect().width() / 2;
+        grid.insert(node->id, node->scene_Pos.x() + r, node->scene_Pos.y() + r, r);
+        addItem(node);
+        if (selected[node->id]) node->setSelected(true);
+    }
+    if (edgeLayer) {
+        removeItem(edgeLayer);
+        edgeLayer->reserve(edgeCount);
+        for (EdgeItem* edge : std::as_const(edgeItems)) {
+            attachToLayer(edge);
+        }
+        addItem(edgeLayer);
+    } else {
+        for (EdgeItem* edge : std::as_const(edgeItems)) {
+            addItem(edge);
         }
     }
 
-    // Highlight the shortest path
-    NodeItem* current = end;
-    while (previous.contains(current)) {
-        NodeItem* prev = previous[current];
-
-        for (EdgeItem* edge : current->connectedEdges) {
-            if ((edge->start == current && edge->end == prev) ||
-                (edge->start == prev && edge->end == current)) {
-                edge->setPen(Qt::green, 3);
-                break;
-            }
-        }
+    setItemIndexMethod(indexMethod);
+    for (QGraphicsView* view : attachedViews) {
+        view->setUpdatesEnabled(true);
+    }
+}
 
-        current = prev;
+void GraphScene::removeEdge(EdgeItem *edge)
+{
+    // The layer swaps its last edge into the slot the same way
+    if (edgeLayer) {
+        edgeLayer->removeEdge(edge->id);
+        edge->layer = nullptr;
+    }
+    if (edge->geometryQueued) movedEdges.removeOne(edge);
+    treeCache.edgeRemoved(edge->id, edge->end->id, edgeItems.size() - 1, edgeItems.last()->end->id);
+    EdgeItem* last = edgeItems.takeLast();
+    if (last != edge) {
+        edgeItems[edge->id] = last;
+        last->id = edge->id;
     }
+    edge->id = -1;
+    if (edge->scene() == this) removeItem(edge);
+    delete edge;
+    modelDirty = true;
+    ++revision;
 }
 
-void GraphScene::runA_Start(NodeItem* start, NodeItem* end) {
-    QHash<NodeItem*, qreal> gScore;
-    QHash<NodeItem*, qreal> fScore;
-    QHash<NodeItem*, NodeItem*> cameFrom;
-    QSet<NodeItem*> openSet;
-    QList<NodeItem*> openList;
+void GraphScene::setEdgeWeight(EdgeItem *edge, double weight)
+{
+    const double oldWeight = edge->getWeight();
+    if (weight == oldWeight) return;
+    edge->setWeight(weight);
+    treeCache.edgeWeightChanged(edge->id, edge->start->id, edge->end->id, oldWeight, weight);
+    modelDirty = true;
+    ++revision;
+}
 
-    // Initialize all nodes
-    for (QGraphicsItem* item : items()) {
-        NodeItem* node = dynamic_cast<NodeItem*>(item);
-        if (node) {
-            gScore[node] = std::numeric_limits<qreal>::max(); // Initialize gScore as infinity
-            fScore[node] = std::numeric_limits<qreal>::max(); // Initialize fScore as infinity
+void GraphScene::attachToLayer(EdgeItem *edge)
+{
+    const EdgeGeometry geometry = edge->geometry();
+    edgeLayer->addEdge(geometry.line, geometry.arrowHead, geometry.labelPos,
+                       QString::number(edge->getWeight()), edge->edgePen());
+    edge->layer = edgeLayer;
+}
+
+void GraphScene::setEdgeLayerEnabled(bool enabled)
+{
+    if (enabled == edgeLayerEnabled()) return;
+
+    if (enabled) {
+        edgeLayer = new EdgeLayerItem();
+        edgeLayer->setDetail(edgeLayerDetail());
+        edgeLayer->setPaintCounter(&PerfStats::instance()->itemsPainted);
+        addItem(edgeLayer);
+        // Taking each edge item out of the scene is a linear search; one
+        // clear and a rebuild that attaches the edges to the layer is not
+        rebuildItems(std::vector<char>(nodeItems.size(), 0), std::vector<char>(edgeItems.size(), 0));
+    } else {
+        removeItem(edgeLayer);
+        for (EdgeItem* edge : std::as_const(edgeItems)) {
+            edge->layer = nullptr;
+            addItem(edge);
         }
+        delete edgeLayer;
+        edgeLayer = nullptr;
     }
+}
 
-    gScore[start] = 0;
-    fScore[start] = 0;  // No heuristic, just set to 0
-    openSet.insert(start);  // Add start node to the open set
-    openList.append(start); // Add start node to the open list
+void GraphScene::setLevelOfDetailEnabled(bool enabled)
+{
+    staticInformation::instance()->lodEnabled = enabled;
+    if (edgeLayer) edgeLayer->setDetail(edgeLayerDetail());
+    update();
+}
 
-    while (!openList.isEmpty()) {
-        // Sort open list based on fScore
-        std::sort(openList.begin(), openList.end(), [&](NodeItem* a, NodeItem* b) {
-            return fScore[a] < fScore[b]; // Compare by fScore (only gScore here, no heuristic)
-        });
+void GraphScene::setCompactItems(bool enabled)
+{
+    GV_TRACE_SCOPE("GraphScene::setCompactItems");
+    staticInformation::instance()->compactItems = enabled;
+    const qint64 before = Trace::heapBytes();
+    for (NodeItem* node : std::as_const(nodeItems)) node->setCompact(enabled);
+    for (EdgeItem* edge : std::as_const(edgeItems)) edge->setCompact(enabled);
+
+    // Shift the load-time figure by what the conversion freed or allocated
+    auto stats = PerfStats::instance();
+    const int elements = nodeItems.size() + edgeItems.size();
+    if (stats->sceneBytesPerElement >= 0 && elements > 0 && before > 0) {
+        stats->sceneBytesPerElement += double(Trace::heapBytes() - before) / elements;
+    }
+}
 
-        NodeItem* current = openList.takeFirst();  // Get node with lowest fScore
-        openSet.remove(current); // Remove it from open set
+void GraphScene::nodeMoved(NodeItem *node)
+{
+    const qreal r = node->rect().width() / 2;
+    grid.move(node->id, node->scene_Pos.x() + r, node->scene_Pos.y() + r);
+    for (EdgeItem* edge : std::as_const(node->connectedEdges)) {
+        if (!edge->geometryQueued) {
+            edge->geometryQueued = true;
+            movedEdges.append(edge);
+        }
+    }
+    modelDirty = true;
+    if (!flushPending) {
+        flushPending = true;
+        QTimer::singleShot(0, this, &GraphScene::flushEdgeGeometry);
+    }
+}
 
-        if (current == end) break; // We found the shortest path
+void GraphScene::setNodePositions(const std::vector<double> &xs, const std::vector<double> &ys)
+{
+    if (int(xs.size()) != nodeItems.size() || int(ys.size()) != nodeItems.size()) return;
+    for (NodeItem* node : std::as_const(nodeItems)) {
+        node->setPos(xs[node->id] - node->rect().x(), ys[node->id] - node->rect().y());
+    }
+}
 
-        // Explore neighbors
-        for (EdgeItem* edge : current->connectedEdges) {
-            NodeItem* neighbor = (edge->start == current) ? edge->end : nullptr;
-            if(!neighbor) continue;
-            qreal tentative_gScore = gScore[current] + edge->getWeight();  // Calculate the cost to reach the neighbor
+void GraphScene::flushEdgeGeometry()
+{
+    GV_TRACE_SCOPE("GraphScene::flushEdgeGeometry");
+    // setGeometry() invalidates the old and new bounds of each edge only
+    for (EdgeItem* edge : std::as_const(movedEdges)) {
+        edge->geometryQueued = false;
+        edge->updatePosition();
+    }
+    movedEdges.clear();
+    flushPending = false;
+}
 
-            // Only consider this neighbor if the new path to it is better
-            if (tentative_gScore < gScore[neighbor]) {
-                cameFrom[neighbor] = current;
-                gScore[neighbor] = tentative_gScore;
-                fScore[neighbor] = gScore[neighbor]; // Since there's no heuristic, fScore is just gScore
+NodeItem *GraphScene::findNode(const QString &label) const
+{
+    int id = labels.find(label);
+    return id >= 0 ? nodeItems[id] : nullptr;
+}
 
-                // Only add to openList if it's not already in openSet
-                if (!openSet.contains(neighbor)) {
-                    openSet.insert(neighbor);
-                    openList.append(neighbor);  // Add neighbor to open list
-                }
-            }
-        }
+QVector<NodeItem *> GraphScene::searchNodes(const QString &text, int limit) const
+{
+    QVector<NodeItem*> result;
+    const QVector<int> ids = labels.search(text, limit);
+    result.reserve(ids.size());
+    for (int id : ids) {
+        result.append(nodeItems[id]);
     }
+    return result;
+}
 
-    // Reconstruct and highlight the path
-    NodeItem* current = end;
-    while (cameFrom.contains(current)) {
-        NodeItem* prev = cameFrom[current];
+NodeItem *GraphScene::nodeAt(const QPointF &scenePos) const
+{
+    int id = grid.nodeAt(scenePos.x(), scenePos.y());
+    if (id >= 0) return nodeItems[id];
+    // The grid only holds the discs; a label can reach past its node.
+    // The topmost item decides, so an edge drawn over a label wins.
+    const QList<QGraphicsItem*> hits = items(scenePos);
+    for (QGraphicsItem* item : hits) {
+        if (item == edgeLayer || item == tempEdge) continue;
+        if (item->parentItem()) item = item->parentItem();
+        return qgraphicsitem_cast<NodeItem*>(item);
+    }
+    return nullptr;
+}
 
-        // Highlight the edge
-        for (EdgeItem* edge : current->connectedEdges) {
-            if ((edge->start == current && edge->end == prev) ||
-                (edge->start == prev && edge->end == current)) {
-                edge->setPen(Qt::darkMagenta, 3); // Highlight the path
-                break;
-            }
+EdgeItem *GraphScene::edgeAt(const QPointF &scenePos) const
+{
+    // The edge layer keeps its own grid of segments
+    if (edgeLayer) {
+        int edgeId = edgeLayer->edgeAt(scenePos);
+        return edgeId >= 0 ? edgeItems[edgeId] : nullptr;
+    }
+    QGraphicsItem* item = itemAt(scenePos, QTransform());
+    // Labels are child items; resolve them to the edge they belong to
+    if (item && item->parentItem()) item = item->parentItem();
+    return qgraphicsitem_cast<EdgeItem*>(item);
+}
+
+GraphData GraphScene::graphData() const
+{
+    GraphData data;
+    data.nodes.resize(nodeItems.size());
+    for (NodeItem* node : nodeItems) {
+        GraphData::Node& out = data.nodes[node->id];
+        qreal r = node->rect().width() / 2;
+        out.x = node->scene_Pos.x() + r;
+        out.y = node->scene_Pos.y() + r;
+        out.color = node->brush().color().rgba();
+        out.label = node->label;
+    }
+
+    data.edges.resize(edgeItems.size());
+    for (EdgeItem* edge : edgeItems) {
+        data.edges[edge->id] = {edge->start->id, edge->end->id, edge->getWeight()};
+    }
+    return data;
+}
+
+void GraphScene::loadGraph(const GraphData &data)
+{
+    GV_TRACE_SCOPE("GraphScene::loadGraph");
+    clearScene();
+    const qint64 heapBefore = Trace::heapBytes();
+
+    // Suspend the BSP index and repaints; both are rebuilt once at the end
+    // instead of after every insertion.
+    const ItemIndexMethod indexMethod = itemIndexMethod();
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+    const QList<QGraphicsView*> attachedViews = views();
+    for (QGraphicsView* view : attachedViews) {
+        view->setUpdatesEnabled(false);
+    }
+
+    auto info = staticInformation::instance();
+    int nodeR = info->nodeR / 2;
+    const int nodeCount = int(data.nodes.size());
+    const int edgeCount = int(data.edges.size());
+
+    nodeItems.reserve(nodeCount);
+    edgeItems.reserve(edgeCount);
+    grid.reserve(nodeCount);
+
+    // Load nodes
+    for (const GraphData::Node& n : data.nodes) {
+        NodeItem* node = new NodeItem(n.x - nodeR, n.y - nodeR, nodeR * 2, nodeR * 2, n.label);
+        node->setBrush(QColor::fromRgba(n.color));
+        node->id = nodeItems.size();
+        nodeItems.append(node);
+        labels.insert(node->label, node->id);
+        grid.insert(node->id, n.x, n.y, nodeR);
+    }
+
+    // Load edges, leaving their geometry for the parallel pass below
+    for (const GraphData::Edge& e : data.edges) {
+        NodeItem* startNode = nodeItems[e.source];
+        NodeItem* endNode = nodeItems[e.target];
+        EdgeItem* edge = new EdgeItem(startNode, endNode, e.weight, true);
+        edge->id = edgeItems.size();
+        edgeItems.append(edge);
+    }
+
+    // Edge geometry only depends on the node centers
+    std::vector<EdgeGeometry> geometry(edgeCount);
+    const qreal arrowSize = edgeCount ? edgeItems.first()->arrowLength() : 0;
+    parallelFor(edgeCount, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const GraphData::Node& a = data.nodes[data.edges[i].source];
+            const GraphData::Node& b = data.nodes[data.edges[i].target];
+            geometry[i] = EdgeItem::computeGeometry(QPointF(a.x, a.y), QPointF(b.x, b.y), arrowSize);
         }
+    });
+
+    for (int i = 0; i < edgeCount; ++i) {
+        edgeItems[i]->setGeometry(geometry[i]);
+    }
+    for (NodeItem* node : std::as_const(nodeItems)) {
+        addItem(node);
+    }
+    if (edgeLayer) {
+        removeItem(edgeLayer);
+        edgeLayer->reserve(edgeCount);
+        for (EdgeItem* edge : std::as_const(edgeItems)) {
+            attachToLayer(edge);
+        }
+        addItem(edgeLayer);
+    } else {
+        for (EdgeItem* edge : std::as_const(edgeItems)) {
+            addItem(edge);
+        }
+    }
+    modelDirty = true;
+    ++revision;
+
+    setItemIndexMethod(indexMethod);
+    for (QGraphicsView* view : attachedViews) {
+        view->setUpdatesEnabled(true);
+    }
+
+    // Items, registry and indexes together; the scene's own BSP index is
+    // only built on the next paint or lookup and is not included
+    const int elements = nodeCount + edgeCount;
+    if (heapBefore > 0 && elements > 0) {
+        PerfStats::instance()->sceneBytesPerElement = double(Trace::heapBytes() - heapBefore) / elements;
+    }
+}
+
+QSharedPointer<const GraphModel> GraphScene::model()
+{
+    if (!modelDirty && cachedModel) return cachedModel;
+    GV_TRACE_SCOPE("GraphScene::model");
+
+    std::vector<double> xs(nodeItems.size());
+    std::vector<double> ys(nodeItems.size());
+    for (NodeItem* node : std::as_const(nodeItems)) {
+        xs[node->id] = node->scene_Pos.x();
+        ys[node->id] = node->scene_Pos.y();
+    }
+
+    std::vector<GraphModel::Edge> modelEdges(edgeItems.size());
+    for (EdgeItem* edge : std::as_const(edgeItems)) {
+        modelEdges[edge->id] = {edge->start->id, edge->end->id, edge->getWeight()};
+    }
+
+    cachedModel = QSharedPointer<const GraphModel>::create(std::move(xs), std::move(ys), std::move(modelEdges));
+    modelDirty = false;
+    return cachedModel;
+}
+
+void GraphScene::resetEdgePens()
+{
+    auto info = staticInformation::instance();
+    for (EdgeItem* edge : std::as_const(edgeItems)) {
+        edge->setPen(info->edgeColor, 2);
+    }
+}
+
+void GraphScene::resetNodePens()
+{
+    for (NodeItem* node : std::as_const(nodeItems)) {
+        node->setPen(QPen());
+    }
+}
+
+void GraphScene::applyPath(const PathResult &path, const QColor &color)
+{
+    // Highlight the shortest path
+    highlightEdges(path.edges, color);
+}
 
-        current = prev;
+void GraphScene::highlightEdges(const std::vector<int> &edgeIds, const QColor &color)
+{
+    for (int edgeId : edgeIds) {
+        edgeItems[edgeId]->setPen(color, 3);
+        edgeItems[edgeId]->update();
     }
 }
 
 
 void GraphScene::mousePressEvent(QGraphicsSceneMouseEvent *event) {
+    // Nodes are looked up in the grid index first; only a miss falls back
+    // to the item index, for edges
     if (*stateMouse == Insert_State) {
-        QGraphicsItem *clickedItem = itemAt(event->scenePos(), QTransform());
-        if (!clickedItem && event->button() == Qt::LeftButton) {
-            auto info = staticInformation::instance();
-            int nodeR = info->nodeR / 2;
-            QString label = QInputDialog::getText(nullptr, "Node Label", "Enter node label:");
-            auto node = new NodeItem(event->scenePos().x() - nodeR, event->scenePos().y() - nodeR, nodeR * 2, nodeR * 2, label);
-
-            addItem(node);
+        if (event->button() == Qt::LeftButton && !nodeAt(event->scenePos())) {
+            if (EdgeItem* edge = edgeAt(event->scenePos())) {
+                // Clicking an edge edits its weight
+                bool ok = false;
+                double weight = QInputDialog::getDouble(nullptr, "Edge Weight", "Enter edge weight:", edge->getWeight(),
+                                                        -1e9, 1e9, 2, &ok);
+                if (ok) setEdgeWeight(edge, weight);
+            } else {
+                auto info = staticInformation::instance();
+                int nodeR = info->nodeR / 2;
+                QString label = QInputDialog::getText(nullptr, "Node Label", "Enter node label:");
+                auto node = new NodeItem(event->scenePos().x() - nodeR, event->scenePos().y() - nodeR, nodeR * 2, nodeR * 2, label);
+
+                addNode(node);
+            }
         }
     } else if (*stateMouse == Remove_State) {
-        QGraphicsItem *clickedItem = itemAt(event->scenePos(), QTransform());
-        if (clickedItem && event->button() == Qt::LeftButton) {
-            NodeItem* node = dynamic_cast<NodeItem*>(clickedItem);
-            if (node) {
-                // Delete all connected edges
-                auto edgesCopy = node->connectedEdges; // Make a copy to avoid modifying during iteration
-                for (EdgeItem* edge : edgesCopy) {
-                    removeItem(edge);
-                    delete edge;
-                }
-                node->connectedEdges.clear(); // Just to be safe
+        if (event->button() == Qt::LeftButton) {
+            if (NodeItem* node = nodeAt(event->scenePos())) {
+                removeNode(node);
+            } else if (EdgeItem* edge = edgeAt(event->scenePos())) {
+                removeEdge(edge);
             }
-
-            removeItem(clickedItem);
-            delete clickedItem;
         }
-        //QGraphicsItem *clickedItem = itemAt(event->scenePos(), QTransform());
-        //if (clickedItem && event->button() == Qt::LeftButton) {
-        //    removeItem(clickedItem);
-        //    delete clickedItem;
-        //}
     } else if (*stateMouse == Connect_State) {
-        QGraphicsItem *clickedItem = itemAt(event->scenePos(), QTransform());
-        if (clickedItem && event->button() == Qt::LeftButton) {
-            NodeItem* node = dynamic_cast<NodeItem*>(clickedItem);
-            if (node) {
+        if (event->button() == Qt::LeftButton) {
+            if (NodeItem* node = nodeAt(event->scenePos())) {
                 startNode = node;
                 auto info = staticInformation::instance();
                 int nodeR = info->nodeR / 2;
@@ -223,48 +694,18 @@ void GraphScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
         tempEdge->setLine(QLineF(startNode->scene_Pos + QPointF(nodeR, nodeR), event->scenePos()));
     }
 
-    // Check if a node is moved
-    if(*stateMouse == Drag_State){
-        QList<QGraphicsItem *> itemsAtScene = items(event->scenePos());
-        for (QGraphicsItem *item : itemsAtScene) {
-            NodeItem* node = dynamic_cast<NodeItem*>(item);
-            if (node) {
-                emit node->positionChanged();
-                update();
-            }
-        }
-    }
-
-
     QGraphicsScene::mouseMoveEvent(event);
 }
 
 void GraphScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
     if (tempEdge && startNode) {
-        // QGraphicsItem *clickedItem = itemAt(event->scenePos(), QTransform());
-        // NodeItem* endNode = dynamic_cast<NodeItem*>(clickedItem);
-        QList<QGraphicsItem *> itemsUnderCursor = items(event->scenePos());
-        NodeItem* endNode = nullptr;
-
-        // Find a NodeItem under the cursor
-        for (QGraphicsItem *item : itemsUnderCursor) {
-            endNode = dynamic_cast<NodeItem*>(item);
-            if (endNode) {
-                break;
-            }
-        }
+        NodeItem* endNode = nodeAt(event->scenePos());
 
         if (endNode && endNode != startNode) {
             //auto info = staticInformation::instance();
             double weight = QInputDialog::getDouble(nullptr, "Edge Weight", "Enter edge weight:");
             EdgeItem* edge = new EdgeItem(startNode, endNode, weight);
-
-            startNode->connectedEdges.append(edge);
-            startNode->neighbors.append(endNode);
-            //endNode->connectedEdges.append(edge);
-            //endNode->neighbors.append(startNode);
-
-            addItem(edge);
+            addEdge(edge);
         }
         // else{
         //     qDebug() << "97";
@@ -277,6 +718,87 @@ void GraphScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
     QGraphicsScene::mouseReleaseEvent(event);
 }
 
+void GraphScene::keyPressEvent(QKeyEvent *event)
+{
+    // Nodes are only selectable in Drag_State
+    if (event->key() == Qt::Key_Delete || event->key() == Qt::Key_Backspace) {
+        QVector<NodeItem*> selected;
+        const QList<QGraphicsItem*> selection = selectedItems();
+        for (QGraphicsItem* item : selection) {
+            if (NodeItem* node = qgraphicsitem_cast<NodeItem*>(item)) selected.append(node);
+        }
+        if (!selected.isEmpty()) {
+            removeNodes(selected);
+            event->accept();
+            return;
+        }
+    }
+    QGraphicsScene::keyPressEvent(event);
+}
+
+void GraphView::setOverlayEnabled(bool enabled)
+{
+    if (overlay == enabled) return;
+    overlay = enabled;
+    // The overlay sits in viewport coordinates, so partial or scrolled
+    // updates would leave stale copies of it behind
+    if (enabled) {
+        updateMode = viewportUpdateMode();
+        setViewportUpdateMode(FullViewportUpdate);
+    } else {
+        setViewportUpdateMode(updateMode);
+    }
+    viewport()->update();
+}
+
+void GraphView::paintEvent(QPaintEvent *event)
+{
+    GV_TRACE_SCOPE("GraphView::paintEvent");
+    auto stats = PerfStats::instance();
+    stats->itemsPainted = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QGraphicsView::paintEvent(event);
+    stats->frameMs = timer.nsecsElapsed() / 1e6;
+    GV_TRACE_COUNTER("items painted", stats->itemsPainted);
+}
+
+void GraphView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsView::drawForeground(painter, rect);
+    if (!overlay) return;
+
+    auto stats = PerfStats::instance();
+    QStringList lines;
+    lines << QString("frame %1 ms").arg(stats->frameMs, 0, 'f', 1)
+          << QString("items painted %1").arg(stats->itemsPainted);
+    if (stats->lastQueryMs >= 0) {
+        QString query = QString("%1: %2 ms").arg(stats->lastQuery).arg(stats->lastQueryMs);
+        if (stats->lastQueryExpanded >= 0) query += QString(", %1 expanded").arg(stats->lastQueryExpanded);
+        lines << query;
+    }
+    if (stats->sceneBytesPerElement >= 0) {
+        lines << QString("scene %1 B/element (%2 items)").arg(stats->sceneBytesPerElement, 0, 'f', 0)
+                     .arg(staticInformation::instance()->compactItems ? "compact" : "full");
+    }
+    if (qint64 peak = Trace::peakMemoryBytes()) {
+        lines << QString("peak memory %1 MB").arg(peak / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+
+    painter->save();
+    painter->resetTransform();
+    const QFontMetrics metrics(painter->font());
+    int width = 0;
+    for (const QString& line : std::as_const(lines)) width = qMax(width, metrics.horizontalAdvance(line));
+    const QRect box(8, 8, width + 12, metrics.height() * lines.size() + 8);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QColor(0, 0, 0, 160));
+    painter->drawRect(box);
+    painter->setPen(Qt::white);
+    painter->drawText(box.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop, lines.join('\n'));
+    painter->restore();
+}
+
 Graph::Graph(QWidget *parent) : QWidget(parent) {
     QVBoxLayout* laymain = new QVBoxLayout();
     laymain->setContentsMargins(0,0,0,0);
@@ -321,6 +843,12 @@ Graph::Graph(QWidget *parent) : QWidget(parent) {
     connect(btnImport, &QPushButton::clicked, this, [=](){
         importGraph();
     });
+    QPushButton* btnSaveImage = new QPushButton("Save Image");
+    connect(btnSaveImage, &QPushButton::clicked, this, &Graph::saveImage);
+    QPushButton* btnConvert = new QPushButton("Convert");
+    connect(btnConvert, &QPushButton::clicked, this, [=](){
+        convertGraph();
+    });
 
     connect(btnInsert, &QPushButton::clicked, this, [=](){
         *stateMouse = Insert_State;
@@ -344,58 +872,233 @@ Graph::Graph(QWidget *parent) : QWidget(parent) {
         scene->clearScene();
     });
 
-    QPushButton* btnDijkstra = new QPushButton("Run Dijkstra");
-    connect(btnDijkstra, &QPushButton::clicked, this, [=]() {
-        QList<QGraphicsItem*> allItems = scene->items();
-        QString n1_label = QInputDialog::getText(nullptr, "Node Label Start", "Enter node label Start:");
-        QString n2_label = QInputDialog::getText(nullptr, "Node Label End", "Enter node label End:");
-        NodeItem* n1 = nullptr;
-        NodeItem* n2 = nullptr;
-        for(QGraphicsItem* item: allItems){
-            NodeItem* item_n = dynamic_cast<NodeItem*>(item);
-            EdgeItem* item_e = dynamic_cast<EdgeItem*>(item);
-            auto info = staticInformation::instance();
-            if(item_e) item_e->setPen(info->edgeColor, 2);
-            if(!item_n) continue;
-            if(item_n->labelItem->toPlainText() == n1_label){
-                n1 = item_n;
-            }
-            if(item_n->labelItem->toPlainText() == n2_label){
-                n2 = item_n;
-            }
+    QComboBox* comboHeuristic = new QComboBox();
+    comboHeuristic->addItem("Euclidean", Euclidean_Heuristic);
+    comboHeuristic->addItem("Landmarks (ALT)", Landmark_Heuristic);
+    comboHeuristic->addItem("No heuristic", No_Heuristic);
+
+    lblStats = new QLabel();
+
+    pathRunner = new PathQueryRunner(this);
+    connect(pathRunner, &PathQueryRunner::progress, this, [=](int settled) {
+        lblStats->setText(QString("%1: searching, %2 nodes settled...").arg(queryName).arg(settled));
+    });
+    connect(pathRunner, &PathQueryRunner::canceled, this, [=]() {
+        lblStats->setText(QString("%1: canceled").arg(queryName));
+    });
+    connect(pathRunner, &PathQueryRunner::finished, this, [=](const PathOutcome& outcome) {
+        if (scene->topologyRevision() != queryRevision) {
+            lblStats->setText(QString("%1: graph changed during the search, result discarded").arg(queryName));
+            return;
         }
-        if (n1 && n2) {
-            scene->runDijkstra(n1, n2);
+        QColor color = outcome.query.algorithm == AStar_Algorithm ? QColor(Qt::darkMagenta) : QColor(Qt::green);
+        scene->resetEdgePens();
+        if (outcome.trace) {
+            // The path is drawn once the replay reaches the end
+            tracePath = outcome.result;
+            traceColor = color;
+            traceRevision = queryRevision;
+            tracePlayer->setTrace(outcome.trace);
+            sliderTrace->setRange(0, outcome.trace->size());
+            tracePlayer->play();
         } else {
-            QMessageBox::information(this, "Dijkstra", "Please select 2 valid nodes.");
+            scene->applyPath(outcome.result, color);
         }
+        showPathStats(queryName, outcome.result, outcome.elapsedMs);
+        if (outcome.tree) scene->pathTrees().insert(outcome.tree);
+
+        auto stats = PerfStats::instance();
+        stats->lastQuery = queryName;
+        stats->lastQueryMs = outcome.elapsedMs;
+        stats->lastQueryExpanded = outcome.result.settled;
+    });
+
+    QPushButton* btnDijkstra = new QPushButton("Run Dijkstra");
+    connect(btnDijkstra, &QPushButton::clicked, this, [=]() {
+        PathQuery query;
+        query.algorithm = Dijkstra_Algorithm;
+        startPathQuery("Dijkstra", query);
+    });
+
+    QPushButton* btnBidirectional = new QPushButton("Run Bidirectional");
+    connect(btnBidirectional, &QPushButton::clicked, this, [=]() {
+        PathQuery query;
+        query.algorithm = Bidirectional_Algorithm;
+        startPathQuery("Bidirectional Dijkstra", query);
     });
 
     QPushButton* btnA_Start = new QPushButton("Run A*");
     connect(btnA_Start, &QPushButton::clicked, this, [=]() {
-        QList<QGraphicsItem*> allItems = scene->items();
-        QString n1_label = QInputDialog::getText(nullptr, "Node Label Start", "Enter node label Start:");
-        QString n2_label = QInputDialog::getText(nullptr, "Node Label End", "Enter node label End:");
-        NodeItem* n1 = nullptr;
-        NodeItem* n2 = nullptr;
-        for(QGraphicsItem* item: allItems){
-            NodeItem* item_n = dynamic_cast<NodeItem*>(item);
-            EdgeItem* item_e = dynamic_cast<EdgeItem*>(item);
-            auto info = staticInformation::instance();
-            if(item_e) item_e->setPen(info->edgeColor, 2);
-            if(!item_n) continue;
-            if(item_n->labelItem->toPlainText() == n1_label){
-                n1 = item_n;
-            }
-            if(item_n->labelItem->toPlainText() == n2_label){
-                n2 = item_n;
-            }
+        PathQuery query;
+        query.algorithm = AStar_Algorithm;
+        query.heuristic = static_cast<HeuristicMode>(comboHeuristic->currentData().toInt());
+        startPathQuery("A* (" + comboHeuristic->currentText() + ")", query);
+    });
+
+    QComboBox* comboSpanning = new QComboBox();
+    comboSpanning->addItem("Kruskal", Kruskal_Algorithm);
+    comboSpanning->addItem("Prim", Prim_Algorithm);
+    comboSpanning->addItem("Boruvka (parallel)", Boruvka_Algorithm);
+
+    QPushButton* btnSpanning = new QPushButton("Run MST");
+    connect(btnSpanning, &QPushButton::clicked, this, [=]() {
+        GV_TRACE_SCOPE("Graph::runSpanningTree");
+        QElapsedTimer timer;
+        timer.start();
+        auto algorithm = static_cast<SpanningAlgorithm>(comboSpanning->currentData().toInt());
+        SpanningForest forest = SpanningTree::run(*scene->model(), algorithm);
+        qint64 elapsedMs = timer.elapsed();
+
+        auto stats = PerfStats::instance();
+        stats->lastQuery = "MST (" + comboSpanning->currentText() + ")";
+        stats->lastQueryMs = elapsedMs;
+        stats->lastQueryExpanded = -1;
+
+        scene->resetEdgePens();
+        scene->highlightEdges(forest.edges, QColor(Qt::darkCyan));
+        lblStats->setText(QString("MST (%1): %2 edges, total weight %3, %4 tree(s), %5 ms")
+                              .arg(comboSpanning->currentText()).arg(int(forest.edges.size()))
+                              .arg(forest.totalWeight).arg(forest.components).arg(elapsedMs));
+    });
+
+    QLineEdit* editSearch = new QLineEdit();
+    editSearch->setPlaceholderText("Search node by ID or label");
+    editSearch->setClearButtonEnabled(true);
+    connect(editSearch, &QLineEdit::returnPressed, this, [=]() {
+        searchNode(editSearch->text());
+    });
+
+    QCheckBox* checkLod = new QCheckBox("Level of detail");
+    checkLod->setChecked(staticInformation::instance()->lodEnabled);
+    connect(checkLod, &QCheckBox::toggled, this, [=](bool enabled) {
+        scene->setLevelOfDetailEnabled(enabled);
+    });
+
+    QCheckBox* checkEdgeLayer = new QCheckBox("Edge layer");
+    connect(checkEdgeLayer, &QCheckBox::toggled, this, [=](bool enabled) {
+        scene->setEdgeLayerEnabled(enabled);
+    });
+
+    QCheckBox* checkCompact = new QCheckBox("Compact items");
+    checkCompact->setChecked(staticInformation::instance()->compactItems);
+    connect(checkCompact, &QCheckBox::toggled, this, [=](bool enabled) {
+        scene->setCompactItems(enabled);
+        view->viewport()->update();
+    });
+
+    layoutRunner = new LayoutRunner(this);
+    QPushButton* btnLayout = new QPushButton("Auto Layout");
+    connect(btnLayout, &QPushButton::clicked, this, [=]() {
+        if (layoutRunner->isRunning()) {
+            layoutRunner->stop();
+            return;
         }
-        if (n1 && n2) {
-            scene->runA_Start(n1, n2);
+        layoutRevision = scene->topologyRevision();
+        btnLayout->setText("Stop Layout");
+        layoutRunner->start(scene->model());
+    });
+    connect(layoutRunner, &LayoutRunner::positionsUpdated, this,
+            [=](const std::vector<double>& xs, const std::vector<double>& ys, int iteration) {
+        if (scene->topologyRevision() != layoutRevision) {
+            layoutRunner->stop();
+            lblStats->setText("Layout: graph changed, stopped");
+            return;
+        }
+        scene->setNodePositions(xs, ys);
+        lblStats->setText(QString("Layout: iteration %1").arg(iteration));
+    });
+    connect(layoutRunner, &LayoutRunner::finished, this, [=]() {
+        btnLayout->setText("Auto Layout");
+    });
+
+    QCheckBox* checkOverlay = new QCheckBox("Perf overlay");
+    connect(checkOverlay, &QCheckBox::toggled, this, [=](bool enabled) {
+        view->setOverlayEnabled(enabled);
+    });
+
+    QPushButton* btnMatrix = new QPushButton("Distance Matrix");
+    connect(btnMatrix, &QPushButton::clicked, this, &Graph::computeDistanceMatrix);
+
+    btnHierarchy = new QPushButton("Build Hierarchy");
+    connect(btnHierarchy, &QPushButton::clicked, this, &Graph::buildHierarchy);
+
+    QPushButton* btnHierarchyQuery = new QPushButton("Run CH Query");
+    connect(btnHierarchyQuery, &QPushButton::clicked, this, [=]() {
+        if (!hierarchy || hierarchyRevision != scene->topologyRevision()) {
+            QMessageBox::information(this, "Contraction Hierarchy",
+                                     hierarchy ? "The graph changed since the hierarchy was built; rebuild it first."
+                                               : "Build the hierarchy first.");
+            return;
+        }
+        PathQuery query;
+        query.algorithm = Hierarchy_Algorithm;
+        query.hierarchy = hierarchy;
+        startPathQuery("Contraction hierarchy", query);
+    });
+
+    checkRecord = new QCheckBox("Record steps");
+
+    tracePlayer = new TracePlayer(this);
+    QPushButton* btnPlay = new QPushButton("Play / Pause");
+    connect(btnPlay, &QPushButton::clicked, this, [=]() {
+        if (tracePlayer->isPlaying()) {
+            tracePlayer->pause();
         } else {
-            QMessageBox::information(this, "Dijkstra", "Please select 2 valid nodes.");
+            tracePlayer->play();
+        }
+    });
+
+    QComboBox* comboSpeed = new QComboBox();
+    for (int eventsPerSecond : {10, 100, 1000, 10000, 100000, 1000000}) {
+        comboSpeed->addItem(QString("%1 steps/s").arg(eventsPerSecond), eventsPerSecond);
+    }
+    comboSpeed->setCurrentIndex(2);
+    connect(comboSpeed, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=]() {
+        tracePlayer->setSpeed(comboSpeed->currentData().toDouble());
+    });
+
+    sliderTrace = new QSlider(Qt::Horizontal);
+    sliderTrace->setRange(0, 0);
+    connect(sliderTrace, &QSlider::sliderMoved, this, [=](int position) {
+        tracePlayer->pause();
+        tracePlayer->seek(position);
+    });
+    connect(tracePlayer, &TracePlayer::positionChanged, this, [=](int position) {
+        QSignalBlocker blocker(sliderTrace);
+        sliderTrace->setValue(position);
+    });
+    connect(tracePlayer, &TracePlayer::changed, this, [=](const std::vector<int>& nodeIds, const std::vector<int>& edgeIds) {
+        if (scene->topologyRevision() != traceRevision) {
+            // The ids no longer match the trace; drop it and what it painted
+            tracePlayer->clear();
+            sliderTrace->setRange(0, 0);
+            scene->resetNodePens();
+            scene->resetEdgePens();
+            return;
+        }
+        auto info = staticInformation::instance();
+        for (int id : nodeIds) {
+            switch (tracePlayer->nodeState(id)) {
+            case AlgorithmTrace::Node_Settled: scene->nodes()[id]->setPen(QPen(QColor(Qt::darkGreen), 4)); break;
+            case AlgorithmTrace::Node_Labeled: scene->nodes()[id]->setPen(QPen(QColor(255, 140, 0), 3)); break;
+            default: scene->nodes()[id]->setPen(QPen()); break;
+            }
         }
+        for (int id : edgeIds) {
+            switch (tracePlayer->edgeState(id)) {
+            case AlgorithmTrace::Edge_Improved: scene->edges()[id]->setPen(QColor(255, 140, 0), 3); break;
+            case AlgorithmTrace::Edge_Relaxed: scene->edges()[id]->setPen(Qt::lightGray, 2); break;
+            default: scene->edges()[id]->setPen(info->edgeColor, 2); break;
+            }
+        }
+    });
+    connect(tracePlayer, &TracePlayer::finished, this, [=]() {
+        if (scene->topologyRevision() == traceRevision) scene->applyPath(tracePath, traceColor);
+    });
+
+    QPushButton* btnCancel = new QPushButton("Cancel");
+    connect(btnCancel, &QPushButton::clicked, this, [=]() {
+        pathRunner->cancel();
     });
 
     stateMouse = new StateMouse();
@@ -413,12 +1116,33 @@ Graph::Graph(QWidget *parent) : QWidget(parent) {
     layTop->addWidget(btnEdgeColor, 1, 3);
     layTop->addWidget(btnImport, 1, 4);
     layTop->addWidget(btnExport, 1, 5);
+    layTop->addWidget(btnConvert, 0, 5);
+    layTop->addWidget(btnSaveImage, 1, 6);
+    layTop->addWidget(checkLod, 2, 5);
 
     layTop->addWidget(btnDijkstra, 2, 0);
     layTop->addWidget(btnA_Start, 2, 1);
+    layTop->addWidget(comboHeuristic, 2, 2);
+    layTop->addWidget(btnCancel, 2, 3);
+    layTop->addWidget(editSearch, 2, 4);
+    layTop->addWidget(btnSpanning, 3, 0);
+    layTop->addWidget(comboSpanning, 3, 1);
+    layTop->addWidget(checkOverlay, 3, 2);
+    layTop->addWidget(btnBidirectional, 3, 3);
+    layTop->addWidget(btnMatrix, 4, 0);
+    layTop->addWidget(btnHierarchy, 4, 1);
+    layTop->addWidget(btnHierarchyQuery, 4, 2);
+    layTop->addWidget(checkRecord, 4, 3);
+    layTop->addWidget(btnPlay, 4, 4);
+    layTop->addWidget(comboSpeed, 4, 5);
+    layTop->addWidget(sliderTrace, 5, 0, 1, 7);
+    layTop->addWidget(lblStats, 6, 0, 1, 7);
+    layTop->addWidget(btnLayout, 3, 4);
+    layTop->addWidget(checkEdgeLayer, 3, 5);
+    layTop->addWidget(checkCompact, 2, 6);
 
     scene = new GraphScene(stateMouse, this);
-    view = new QGraphicsView(scene, this);
+    view = new GraphView(scene, this);
 
     laymain->addLayout(layTop);
     laymain->addWidget(view);
@@ -427,119 +1151,267 @@ Graph::Graph(QWidget *parent) : QWidget(parent) {
 }
 
 
+void Graph::startPathQuery(const QString &name, PathQuery query)
+{
+    QString n1_label = QInputDialog::getText(nullptr, "Node Label Start", "Enter node label Start:");
+    QString n2_label = QInputDialog::getText(nullptr, "Node Label End", "Enter node label End:");
+    NodeItem* n1 = scene->findNode(n1_label);
+    NodeItem* n2 = scene->findNode(n2_label);
+    if (!n1 || !n2) {
+        QMessageBox::information(this, name, "Please select 2 valid nodes.");
+        return;
+    }
 
-void Graph::exportGraph() {
-    QJsonArray nodesArray;
-    QJsonArray edgesArray;
-    auto itemsInScene = scene->items();
-
-    // Collect nodes
-    for (QGraphicsItem* item : itemsInScene) {
-        NodeItem* node = dynamic_cast<NodeItem*>(item);
-        if (node) {
-            QJsonObject nodeObj;
-            nodeObj["x"] = node->scene_Pos.x();
-            nodeObj["y"] = node->scene_Pos.y();
-            nodeObj["color"] = node->brush().color().name();
-            nodeObj["label"] = node->labelItem->toPlainText();
-            nodesArray.append(nodeObj);
+    tracePlayer->clear();
+    scene->resetEdgePens();
+    scene->resetNodePens();
+    query.source = n1->id;
+    query.target = n2->id;
+    query.recordTrace = checkRecord->isChecked();
+    queryName = name;
+
+    if (query.algorithm == Dijkstra_Algorithm && !query.recordTrace) {
+        // A cached tree goes to the worker, which repairs it and answers
+        // from it. Otherwise the first query from a source runs the
+        // early-exit search; a second one keeps the full tree for later.
+        query.tree = scene->pathTrees().take(query.source);
+        if (query.tree) {
+            queryName = name + " (cached)";
+        } else {
+            query.buildTree = scene->pathTrees().repeatedMiss(query.source);
         }
     }
 
-    // Collect edges
-    for (QGraphicsItem* item : itemsInScene) {
-        EdgeItem* edge = dynamic_cast<EdgeItem*>(item);
-        if (edge) {
-            QJsonObject edgeObj;
-            edgeObj["start_x"] = edge->start->scene_Pos.x();
-            edgeObj["start_y"] = edge->start->scene_Pos.y();
-            edgeObj["end_x"] = edge->end->scene_Pos.x();
-            edgeObj["end_y"] = edge->end->scene_Pos.y();
-            edgeObj["weight"] = edge->getWeight();
-            edgesArray.append(edgeObj);
+    queryRevision = scene->topologyRevision();
+    query.topology = queryRevision;
+    lblStats->setText(QString("%1: searching...").arg(queryName));
+    pathRunner->start(scene->model(), query);
+}
+
+void Graph::computeDistanceMatrix()
+{
+    QString sourceText = QInputDialog::getText(this, "Distance Matrix", "Source node labels (comma separated):");
+    if (sourceText.trimmed().isEmpty()) return;
+    QString targetText = QInputDialog::getText(this, "Distance Matrix", "Target node labels (comma separated):");
+    if (targetText.trimmed().isEmpty()) return;
+
+    QStringList missing;
+    auto resolve = [&](const QString& text, QStringList& names, std::vector<int>& ids) {
+        for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+            QString name = part.trimmed();
+            NodeItem* node = scene->findNode(name);
+            if (!node) {
+                missing << name;
+                continue;
+            }
+            names << name;
+            ids.push_back(node->id);
         }
+    };
+    QStringList sourceNames, targetNames;
+    std::vector<int> sources, targets;
+    resolve(sourceText, sourceNames, sources);
+    resolve(targetText, targetNames, targets);
+    if (!missing.isEmpty()) {
+        QMessageBox::information(this, "Distance Matrix", "Unknown node labels: " + missing.join(", "));
+        return;
     }
 
-    QJsonObject root;
-    root["nodes"] = nodesArray;
-    root["edges"] = edgesArray;
+    QElapsedTimer timer;
+    timer.start();
+    DistanceTable table = DistanceMatrix::compute(*scene->model(), sources, targets);
+    qint64 elapsedMs = timer.elapsed();
+    if (table.negativeCycle) {
+        QMessageBox::warning(this, "Distance Matrix", "The graph has a negative cycle; distances are unbounded.");
+        return;
+    }
+    lblStats->setText(QString("Distance matrix: %1 x %2, %3 ms%4")
+                          .arg(int(sources.size())).arg(int(targets.size())).arg(elapsedMs)
+                          .arg(table.reweighted ? ", negative weights (Johnson reweighting)" : ""));
 
-    // Add radius and global colors
-    auto info = staticInformation::instance();
-    root["nodeRadius"] = info->nodeR;
-    root["nodeColor"] = info->nodeColor.name();
-    root["edgeColor"] = info->edgeColor.name();
-
-    QJsonDocument doc(root);
-    QString fileName = QFileDialog::getSaveFileName(this, "Export Graph", "", "*.json");
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(doc.toJson());
-            file.close();
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Distance Matrix", "", "CSV (*.csv)");
+    if (fileName.isEmpty()) return;
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(DistanceMatrix::toCsv(table, sourceNames, targetNames)) < 0
+        || !file.commit()) {
+        QMessageBox::warning(this, "Distance Matrix", "Cannot write " + fileName + ": " + file.errorString());
+    }
+}
+
+void Graph::buildHierarchy()
+{
+    QSharedPointer<const GraphModel> graph = scene->model();
+    for (int id = 0; id < graph->edgeCount(); ++id) {
+        if (graph->edge(id).weight < 0) {
+            QMessageBox::warning(this, "Contraction Hierarchy", "Contraction hierarchies need non-negative edge weights.");
+            return;
         }
     }
+
+    const quint64 revision = scene->topologyRevision();
+    btnHierarchy->setEnabled(false);
+    lblStats->setText("Contraction hierarchy: building...");
+
+    QElapsedTimer timer;
+    timer.start();
+    auto watcher = new QFutureWatcher<QSharedPointer<const ContractionHierarchy>>(this);
+    connect(watcher, &QFutureWatcher<QSharedPointer<const ContractionHierarchy>>::finished, this, [=]() {
+        watcher->deleteLater();
+        btnHierarchy->setEnabled(true);
+        if (scene->topologyRevision() != revision) {
+            lblStats->setText("Contraction hierarchy: graph changed during preprocessing, result discarded");
+            return;
+        }
+        hierarchy = watcher->result();
+        hierarchyRevision = revision;
+        lblStats->setText(QString("Contraction hierarchy: %1 nodes, %2 shortcuts, %3 ms")
+                              .arg(hierarchy->nodeCount()).arg(hierarchy->shortcutCount()).arg(timer.elapsed()));
+    });
+    watcher->setFuture(QtConcurrent::run([graph]() {
+        return QSharedPointer<const ContractionHierarchy>::create(*graph);
+    }));
 }
 
-void Graph::importGraph() {
-    QString fileName = QFileDialog::getOpenFileName(this, "Import Graph", "", "*.json");
-    if (fileName.isEmpty()) return;
+void Graph::searchNode(const QString &text)
+{
+    QString query = text.trimmed();
+    if (query.isEmpty()) return;
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) return;
+    QVector<NodeItem*> matches = scene->searchNodes(query, 20);
 
-    QByteArray data = file.readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    QJsonObject root = doc.object();
+    // "#12" (or a bare number that is not a label) addresses a node by id
+    bool isId = false;
+    int id = query.startsWith("#") ? query.mid(1).toInt(&isId) : query.toInt(&isId);
+    if (isId && id >= 0 && id < scene->nodes().size() && !scene->findNode(query)) {
+        matches.prepend(scene->nodes()[id]);
+    }
 
-    scene->clear();
+    if (matches.isEmpty()) {
+        lblStats->setText(QString("Search: no node matches \"%1\"").arg(query));
+        return;
+    }
 
-    QMap<QPair<qreal, qreal>, NodeItem*> positionToNode;
+    QStringList names;
+    for (NodeItem* node : std::as_const(matches)) {
+        names.append(QString("%1 (#%2)").arg(node->label).arg(node->id));
+    }
+    view->centerOn(matches.first());
+    lblStats->setText(QString("Search: %1 match(es): %2").arg(matches.size()).arg(names.join(", ")));
+}
 
+void Graph::showPathStats(const QString &algorithm, const PathResult &path, qint64 elapsedMs)
+{
+    QString distance = path.found() ? QString::number(path.distance) : QString("unreachable");
+    lblStats->setText(QString("%1: %2 nodes expanded, distance %3, %4 ms")
+                          .arg(algorithm).arg(path.settled).arg(distance).arg(elapsedMs));
+}
+
+void Graph::exportGraph() {
+    GV_TRACE_SCOPE("Graph::exportGraph");
+    GraphData data = scene->graphData();
+
+    // Add radius and global colors
     auto info = staticInformation::instance();
-    info->nodeR = root["nodeRadius"].toInt(30);  // fallback default
-    info->nodeColor = QColor(root["nodeColor"].toString("#ff0000"));
-    info->edgeColor = QColor(root["edgeColor"].toString("#0000ff"));
+    data.nodeRadius = info->nodeR;
+    data.nodeColor = info->nodeColor.rgba();
+    data.edgeColor = info->edgeColor.rgba();
 
-    // Load nodes
-    QJsonArray nodesArray = root["nodes"].toArray();
-    for (const QJsonValue& val : nodesArray) {
-        QJsonObject obj = val.toObject();
-        qreal x = obj["x"].toDouble();
-        qreal y = obj["y"].toDouble();
-        QString colorStr = obj["color"].toString();
-        QString label = obj["label"].toString();
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Graph", "", kGraphFileFilter);
+    if (fileName.isEmpty()) return;
 
-        int nodeR = info->nodeR / 2;
-        NodeItem* node = new NodeItem(x - nodeR, y - nodeR, nodeR * 2, nodeR * 2, label);
-        node->setBrush(QColor(colorStr));
-        scene->addItem(node);
-        positionToNode[{x, y}] = node;
+    QString error;
+    if (!GraphIO::save(fileName, data, &error)) {
+        QMessageBox::warning(this, "Export Graph", error);
+        return;
+    }
+
+    // Keep the hierarchy next to the file; a stale one is not worth keeping
+    const QString sidecar = ContractionHierarchy::sidecarPath(fileName);
+    if (hierarchy && hierarchyRevision == scene->topologyRevision()) {
+        if (!hierarchy->save(sidecar, &error)) QMessageBox::warning(this, "Export Graph", error);
+    } else if (QFile::exists(sidecar)) {
+        QFile::remove(sidecar);
     }
+}
 
-    // Load edges
-    QJsonArray edgesArray = root["edges"].toArray();
-    for (const QJsonValue& val : edgesArray) {
-        QJsonObject obj = val.toObject();
-        QPointF start(obj["start_x"].toDouble(), obj["start_y"].toDouble());
-        QPointF end(obj["end_x"].toDouble(), obj["end_y"].toDouble());
+void Graph::saveImage() {
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Image", "", "PNG image (*.png);;SVG image (*.svg)",
+                                                    &selectedFilter);
+    if (fileName.isEmpty()) return;
+    const bool svg = QFileInfo(fileName).suffix().compare("svg", Qt::CaseInsensitive) == 0
+                     || (QFileInfo(fileName).suffix().isEmpty() && selectedFilter.startsWith("SVG"));
 
+    if (scene->nodes().isEmpty() && scene->edges().isEmpty()) {
+        QMessageBox::information(this, "Save Image", "The scene is empty.");
+        return;
+    }
 
-        NodeItem* startNode = positionToNode.value({start.x(), start.y()}, nullptr);
-        NodeItem* endNode = positionToNode.value({end.x(), end.y()}, nullptr);
+    QString error;
+    if (svg) {
+        if (!ImageExport::writeSvg(*scene, fileName, &error)) QMessageBox::warning(this, "Save Image", error);
+        return;
+    }
 
-        if (startNode && endNode) {
-            double weight = obj["weight"].toDouble(1.0); // default weight
-            EdgeItem* edge = new EdgeItem(startNode, endNode, weight);
+    bool ok = false;
+    const double scale = QInputDialog::getDouble(this, "Save Image", "Pixels per scene unit:", 1.0, 0.01, 64.0, 2, &ok);
+    if (!ok) return;
+
+    QProgressDialog progress("Rendering image...", "Cancel", 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    auto report = [&](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        return !progress.wasCanceled();
+    };
+    // Tiles are painted on worker threads, so they work from a copy
+    const ImageSnapshot snapshot = ImageExport::snapshot(*scene);
+    if (!ImageExport::writePng(snapshot, fileName, scale, &error, report) && !progress.wasCanceled()) {
+        QMessageBox::warning(this, "Save Image", error);
+    }
+}
 
-            startNode->connectedEdges.append(edge);
-            startNode->neighbors.append(endNode);
-            endNode->connectedEdges.append(edge);
-            endNode->neighbors.append(startNode);
+void Graph::convertGraph() {
+    QString input = QFileDialog::getOpenFileName(this, "Convert Graph: Source", "", kGraphFileFilter);
+    if (input.isEmpty()) return;
+    QString output = QFileDialog::getSaveFileName(this, "Convert Graph: Destination", "", kGraphFileFilter);
+    if (output.isEmpty()) return;
 
-            scene->addItem(edge);
-        }
+    QString error;
+    if (!GraphIO::convert(input, output, &error)) {
+        QMessageBox::warning(this, "Convert Graph", error);
     }
+}
 
-    file.close();
+void Graph::importGraph() {
+    GV_TRACE_SCOPE("Graph::importGraph");
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Graph", "", kGraphFileFilter);
+    if (fileName.isEmpty()) return;
+
+    GraphData data;
+    QString error;
+    if (!GraphIO::load(fileName, data, &error)) {
+        QMessageBox::warning(this, "Import Graph", error);
+        return;
+    }
+
+    auto info = staticInformation::instance();
+    info->nodeR = data.nodeRadius;
+    info->nodeColor = QColor::fromRgba(data.nodeColor);
+    info->edgeColor = QColor::fromRgba(data.edgeColor);
+
+    scene->loadGraph(data);
+
+    hierarchy.reset();
+    const QString sidecar = ContractionHierarchy::sidecarPath(fileName);
+    if (QFile::exists(sidecar)) {
+        auto loaded = QSharedPointer<ContractionHierarchy>::create();
+        if (loaded->load(sidecar, *scene->model(), &error)) {
+            hierarchy = loaded;
+            hierarchyRevision = scene->topologyRevision();
+        } else {
+            lblStats->setText("Contraction hierarchy not loaded: " + error);
+        }
+    }
 }
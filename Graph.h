@@ -9,6 +9,22 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QFileDialog>
+#include <QSharedPointer>
+
+#include "GraphModel.h"
+#include "ShortestPath.h"
+#include "PathTreeCache.h"
+#include "Heuristics.h"
+#include "PathQuery.h"
+#include "LabelIndex.h"
+#include "NodeGridIndex.h"
+#include "GraphIO.h"
+#include "EdgeLayerItem.h"
+#include "LayoutRunner.h"
+#include "SpanningTree.h"
+#include "DistanceMatrix.h"
+#include "Trace.h"
+#include "TracePlayer.h"
 
 enum StateMouse{
     Insert_State,
@@ -30,83 +46,227 @@ public:
     double defaultWeight;
     QColor nodeColor;
     QColor edgeColor;
+
+    // Level of detail, compared against levelOfDetailFromTransform():
+    // below lodLabels labels are skipped, below lodArrows arrowheads, and
+    // below lodPoints nodes are drawn as points and edges as hairlines.
+    bool lodEnabled;
+    double lodLabels;
+    double lodArrows;
+    double lodPoints;
+
+    // Items created from now on draw their labels themselves from shared
+    // QStaticText instead of owning a QGraphicsTextItem each
+    bool compactItems;
+
+    qreal levelOfDetail(const QPainter* painter) const {
+        return lodEnabled ? QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) : 1.0;
+    }
 private:
     staticInformation(){
         nodeR = 30;
         defaultWeight = 1.0;
         nodeColor = QColor(Qt::red);
         edgeColor = QColor(Qt::blue);
+        lodEnabled = true;
+        lodLabels = 0.6;
+        lodArrows = 0.35;
+        lodPoints = 0.15;
+        compactItems = false;
+    }
+
+};
+
+// Numbers shown by the performance overlay (GraphView). GUI thread only.
+class PerfStats{
+public:
+    static PerfStats* instance(){
+        static PerfStats* ins = nullptr;
+        if(ins == nullptr){
+            ins = new PerfStats();
+        }
+        return ins;
     }
+    double frameMs = 0;         // previous frame
+    int itemsPainted = 0;       // reset at the start of every frame
+    QString lastQuery;
+    qint64 lastQueryMs = -1;
+    int lastQueryExpanded = -1;
+    double sceneBytesPerElement = -1;   // heap per node/edge, see GraphScene::loadGraph
+};
+
+// Text label that is not drawn when zoomed out past staticInformation::lodLabels
+class LodTextItem : public QGraphicsTextItem {
+public:
+    using QGraphicsTextItem::QGraphicsTextItem;
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override {
+        auto info = staticInformation::instance();
+        if (info->levelOfDetail(painter) < info->lodLabels)
+            return;
+        PerfStats::instance()->itemsPainted++;
+        QGraphicsTextItem::paint(painter, option, widget);
+    }
+};
+
+// Label layouts for compact items. QStaticText is implicitly shared, so
+// every item showing the same string holds one cached layout. GUI thread only.
+class StaticLabelCache {
+public:
+    static QStaticText get(const QString& text);
+    static void clear();
+    // Text block of a label placed like a QGraphicsTextItem at `anchor`
+    static QRectF rect(const QPointF& anchor, const QStaticText& text);
+    static void paint(QPainter* painter, const QPointF& anchor, const QStaticText& text);
+};
 
+// Item types for qgraphicsitem_cast, which is a compare instead of the
+// RTTI walk of dynamic_cast
+enum GraphItemType {
+    Node_ItemType = QGraphicsItem::UserType + 1,
+    Edge_ItemType = QGraphicsItem::UserType + 2
 };
 
 class EdgeItem;
-class NodeItem : public QObject, public QGraphicsEllipseItem {
-    Q_OBJECT
+class NodeItem : public QGraphicsEllipseItem {
 public:
-    NodeItem(qreal x, qreal y, qreal w, qreal h, const QString& labelText = "") : QGraphicsEllipseItem(x, y, w, h) {
+    enum { Type = Node_ItemType };
+    int type() const override { return Type; }
+
+    NodeItem(qreal x, qreal y, qreal w, qreal h, const QString& labelText = "") : QGraphicsEllipseItem(x, y, w, h), label(labelText) {
         auto info = staticInformation::instance();
         setBrush(info->nodeColor);
         scene_Pos = QPointF(this->rect().x(), this->rect().y());
 
-        labelItem = new QGraphicsTextItem(labelText, this);
-        labelItem->setDefaultTextColor(Qt::black);
-        labelItem->setPos(scene_Pos + QPointF(w/2 - 7, h/2 - 12));
+        if (info->compactItems) {
+            staticLabel = StaticLabelCache::get(label);
+        } else {
+            createLabelItem();
+        }
+
+        // Moves are reported through itemChange()
+        setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
+    }
+    // Incident edges, in and out, each listed once. An edge remembers its
+    // slot in both endpoint lists (EdgeItem::slotIn), so removal swaps the
+    // last entry into the freed slot instead of searching the list.
+    QVector<EdgeItem*> connectedEdges;
+
+    void addEdge(EdgeItem* edge);
+    void removeEdge(EdgeItem* edge);
 
-        connect(this, &NodeItem::positionChanged, this, [=](){
-            QRectF sceneBoundingRect = this->mapRectToScene(this->rect());
-            scene_Pos = QPointF(sceneBoundingRect.x(), sceneBoundingRect.y());
-            //labelItem->setPos(scene_Pos);
-        });
+    QRectF boundingRect() const override {
+        QRectF bounds = QGraphicsEllipseItem::boundingRect();
+        if (!labelItem) bounds |= StaticLabelCache::rect(labelAnchor(), staticLabel);
+        return bounds;
     }
-    //QList<EdgeItem*> connectedEdges;
-    QList<EdgeItem*> connectedEdges;
-    QList<NodeItem*> neighbors;
 
-    void addEdge(EdgeItem* edge) {
-        connectedEdges.append(edge);
+    // A compact label is painted by the node, so clicks on it hit the node
+    QPainterPath shape() const override {
+        QPainterPath path = QGraphicsEllipseItem::shape();
+        if (labelItem) return path;
+        QPainterPath label;
+        label.addRect(StaticLabelCache::rect(labelAnchor(), staticLabel));
+        return path.united(label);
     }
 
-    void removeEdge(EdgeItem* edge) {
-        connectedEdges.removeAll(edge);
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override {
+        auto info = staticInformation::instance();
+        PerfStats::instance()->itemsPainted++;
+        const qreal lod = info->levelOfDetail(painter);
+        if (lod < info->lodPoints) {
+            QPen point(brush().color(), 3);
+            point.setCosmetic(true);
+            painter->setPen(point);
+            painter->drawPoint(rect().center());
+            return;
+        }
+        QGraphicsEllipseItem::paint(painter, option, widget);
+        if (!labelItem && lod >= info->lodLabels) StaticLabelCache::paint(painter, labelAnchor(), staticLabel);
     }
+
+    // Switches between a child QGraphicsTextItem and a shared QStaticText
+    void setCompact(bool compact) {
+        if (compact == isCompact()) return;
+        prepareGeometryChange();
+        if (compact) {
+            delete labelItem;
+            labelItem = nullptr;
+            staticLabel = StaticLabelCache::get(label);
+        } else {
+            staticLabel = QStaticText();
+            createLabelItem();
+        }
+    }
+    bool isCompact() const { return !labelItem; }
+
+    // Top-left of the label text block, in item / scene coordinates
+    QPointF labelAnchor() const { return rect().topLeft() + QPointF(rect().width() / 2 - 7, rect().height() / 2 - 12); }
+    QPointF labelScenePos() const { return mapToScene(labelAnchor()); }
+
     QPointF scene_Pos;
-    QGraphicsTextItem* labelItem;
-signals:
-    void positionChanged();
+    QString label;
+    QGraphicsTextItem* labelItem = nullptr;     // null for compact items
+    int id = -1;     // dense index into GraphScene / GraphModel
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant& value) override;
+private:
+    void createLabelItem() {
+        labelItem = new LodTextItem(label, this);
+        labelItem->setDefaultTextColor(Qt::black);
+        labelItem->setPos(labelAnchor());
+    }
+
+    QStaticText staticLabel;
 };
 
-class EdgeItem : public QObject, public QGraphicsItem {
-    Q_OBJECT
+// Precomputed drawing geometry of an edge. Pure function of the two node
+// centers, so it can be computed off the GUI thread for bulk loads.
+struct EdgeGeometry {
+    QLineF line;
+    QPolygonF arrowHead;
+    QPointF labelPos;
+};
+
+// Edges are told about node moves through NodeItem::connectedEdges (see
+// GraphScene::nodeMoved), so neither item needs to be a QObject.
+class EdgeItem : public QGraphicsItem {
 public:
-    EdgeItem(NodeItem* startNode, NodeItem* endNode, double weight = 1.0)
+    enum { Type = Edge_ItemType };
+    int type() const override { return Type; }
+
+    // With deferGeometry the caller must call setGeometry() before the
+    // item is shown (see GraphScene::loadGraph).
+    EdgeItem(NodeItem* startNode, NodeItem* endNode, double weight = 1.0, bool deferGeometry = false)
         : start(startNode), end(endNode), weight(weight) {
         auto info = staticInformation::instance();
         pen = QPen(info->edgeColor, 2);
         arrowSize = 10;
 
-        connect(start, &NodeItem::positionChanged, this, &EdgeItem::updatePosition);
-        connect(end, &NodeItem::positionChanged, this, &EdgeItem::updatePosition);
-
-        label = new QGraphicsTextItem(QString::number(weight), this);
-        label->setDefaultTextColor(Qt::black);
+        if (info->compactItems) {
+            staticLabel = StaticLabelCache::get(QString::number(weight));
+        } else {
+            createLabelItem();
+        }
 
         start->addEdge(this);
-        end->addEdge(this);
+        if (end != start) end->addEdge(this);
 
-        updatePosition();
+        if (!deferGeometry) updatePosition();
     }
     ~EdgeItem() {
         if (start) start->removeEdge(this);
-        if (end) end->removeEdge(this);
+        if (end && end != start) end->removeEdge(this);
     }
 
     QRectF boundingRect() const override {
         qreal extra = (pen.width() + arrowSize) / 2.0;
-        return QRectF(line.p1(), QSizeF(line.p2().x() - line.p1().x(),
-                                        line.p2().y() - line.p1().y()))
+        QRectF bounds = QRectF(line.p1(), QSizeF(line.p2().x() - line.p1().x(),
+                                                 line.p2().y() - line.p1().y()))
             .normalized()
             .adjusted(-extra, -extra, extra, extra);
+        if (!label) bounds |= StaticLabelCache::rect(labelPos, staticLabel);
+        return bounds;
     }
 
     double getWeight() const { return weight; }
@@ -115,64 +275,129 @@ public:
         weight = w;
         if (label) {
             label->setPlainText(QString::number(weight));
+        } else {
+            prepareGeometryChange();
+            staticLabel = StaticLabelCache::get(QString::number(weight));
         }
+        if (layer) layer->setEdgeText(id, QString::number(weight));
     }
 
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override {
         if (!start || !end)
             return;
 
-        painter->setPen(pen);
+        auto info = staticInformation::instance();
+        PerfStats::instance()->itemsPainted++;
+        qreal lod = info->levelOfDetail(painter);
+
+        // A cosmetic hairline is much cheaper than a scaled wide pen
+        painter->setPen(lod < info->lodPoints ? QPen(pen.color(), 0) : pen);
         painter->drawLine(line);
 
+        if (lod < info->lodArrows)
+            return;
+
         painter->setBrush(pen.color());
         painter->drawPolygon(arrowHead);
+
+        if (!label && lod >= info->lodLabels) StaticLabelCache::paint(painter, labelPos, staticLabel);
+    }
+
+    void setCompact(bool compact) {
+        if (compact == isCompact()) return;
+        prepareGeometryChange();
+        if (compact) {
+            delete label;
+            label = nullptr;
+            staticLabel = StaticLabelCache::get(QString::number(weight));
+        } else {
+            staticLabel = QStaticText();
+            createLabelItem();
+        }
     }
+    bool isCompact() const { return !label; }
 
     void setPen(QColor color, int weight){
         pen = QPen(color, weight);
+        if (layer) layer->setEdgeStyle(id, pen);
     }
+    const QPen& edgePen() const { return pen; }
 
-public slots:
-    void updatePosition() {
-        auto info = staticInformation::instance();
-        int nodeR = info->nodeR / 2;
-
-        QPointF p1 = start->scene_Pos + QPointF(nodeR, nodeR);
-        QPointF p2 = end->scene_Pos + QPointF(nodeR, nodeR);
-
-        line = QLineF(p1, p2);  // Full line from start to end
+    static EdgeGeometry computeGeometry(const QPointF& p1, const QPointF& p2, qreal arrowSize) {
+        EdgeGeometry geometry;
+        geometry.line = QLineF(p1, p2);  // Full line from start to end
 
-        // Calculate point at 90% of the line (for arrowhead position)
+        // Calculate point at 66% of the line (for arrowhead position)
         QPointF arrowTip = p1 + (p2 - p1) * 0.66;
 
-        double angle = std::atan2(-line.dy(), line.dx());
+        double angle = std::atan2(-geometry.line.dy(), geometry.line.dx());
 
         QPointF arrowP1 = arrowTip - QPointF(std::cos(angle + M_PI / 6) * arrowSize,
                                              -std::sin(angle + M_PI / 6) * arrowSize);
         QPointF arrowP2 = arrowTip - QPointF(std::cos(angle - M_PI / 6) * arrowSize,
                                              -std::sin(angle - M_PI / 6) * arrowSize);
 
-        arrowHead.clear();
-        arrowHead << arrowTip << arrowP1 << arrowP2;
+        geometry.arrowHead << arrowTip << arrowP1 << arrowP2;
 
-        // Label at midpoint
+        // Label next to the arrowhead
+        geometry.labelPos = arrowTip + QPointF(0, 5);
+        return geometry;
+    }
+
+    void setGeometry(const EdgeGeometry& geometry) {
+        prepareGeometryChange();
+        line = geometry.line;
+        arrowHead = geometry.arrowHead;
+        labelPos = geometry.labelPos;
         if (label) {
-            QPointF midpoint = p1 + (p2 - p1) * 0.66 + QPointF(0, 5);
-            label->setPos(midpoint);
+            label->setPos(labelPos);
         }
+        if (layer) layer->setEdgeGeometry(id, line, arrowHead, geometry.labelPos);
+    }
 
-        update();
+    EdgeGeometry geometry() const {
+        return {line, arrowHead, labelPos};
+    }
+
+    qreal arrowLength() const { return arrowSize; }
+
+    void updatePosition() {
+        GV_TRACE_SCOPE("EdgeItem::updatePosition");
+        auto info = staticInformation::instance();
+        int nodeR = info->nodeR / 2;
+
+        QPointF p1 = start->scene_Pos + QPointF(nodeR, nodeR);
+        QPointF p2 = end->scene_Pos + QPointF(nodeR, nodeR);
+
+        setGeometry(computeGeometry(p1, p2, arrowSize));
     }
 public:
     NodeItem* start;
     NodeItem* end;
+    // Index of this edge in start->connectedEdges / end->connectedEdges;
+    // a self-loop is listed once and uses startSlot
+    int startSlot = -1;
+    int endSlot = -1;
+    int& slotIn(const NodeItem* node) { return node == start ? startSlot : endSlot; }
+    int id = -1;     // dense index into GraphScene / GraphModel
+    bool geometryQueued = false;   // in GraphScene's pending edge updates
+    // Set while the scene draws edges through an EdgeLayerItem; the item
+    // itself is then kept out of the scene and forwards its changes here.
+    EdgeLayerItem* layer = nullptr;
 private:
+    void createLabelItem() {
+        label = new LodTextItem(QString::number(weight), this);
+        label->setDefaultTextColor(Qt::black);
+        label->setPos(labelPos);
+    }
+
     QLineF line;
     QPolygonF arrowHead;
+    QPointF labelPos;
     QPen pen;
     qreal arrowSize;
-    QGraphicsTextItem* label;
+    QGraphicsTextItem* label = nullptr;     // null for compact items
+    QStaticText staticLabel;
     double weight;
 };
 
@@ -183,18 +408,113 @@ public:
     GraphScene(StateMouse* state, QObject *parent = nullptr);
     void clearScene();
     void setNodesMoveAble(bool isMoveAble);
-    void runDijkstra(NodeItem* start, NodeItem* end);
-    void runA_Start(NodeItem* start, NodeItem* end);
-    void highlightShortestPath(const QMap<NodeItem*, NodeItem*>& previous, NodeItem* end);
+    void resetEdgePens();
+    void resetNodePens();
+    void applyPath(const PathResult& path, const QColor& color);
+    void highlightEdges(const std::vector<int>& edgeIds, const QColor& color);
+
+    // Item registry. Every node/edge in the scene is tracked here with a
+    // dense id; removal swaps the last item into the freed slot.
+    void addNode(NodeItem* node);
+    void addEdge(EdgeItem* edge);
+    void removeNode(NodeItem* node);
+    void removeEdge(EdgeItem* edge);
+    // Removes many nodes and their edges at once (Delete key on a selection)
+    void removeNodes(const QVector<NodeItem*>& nodes);
+    void setEdgeWeight(EdgeItem* edge, double weight);
+    const QVector<NodeItem*>& nodes() const { return nodeItems; }
+    const QVector<EdgeItem*>& edges() const { return edgeItems; }
+
+    // Label lookups backed by LabelIndex; search() matches prefixes first,
+    // then substrings, case-insensitively.
+    NodeItem* findNode(const QString& label) const;
+    QVector<NodeItem*> searchNodes(const QString& text, int limit = 50) const;
+    // Node whose disc contains the scene point, from the grid index; on a
+    // miss, the node whose label is the topmost item there
+    NodeItem* nodeAt(const QPointF& scenePos) const;
+
+    // Conversion to and from the file representation
+    GraphData graphData() const;
+    void loadGraph(const GraphData& data);
+
+    // Topology snapshot mirroring the registry, rebuilt lazily after edits.
+    QSharedPointer<const GraphModel> model();
+    void markModelDirty() { modelDirty = true; }
+    // Bumped on every structural edit; node moves do not change it.
+    quint64 topologyRevision() const { return revision; }
+    // Shortest-path trees of recent Dijkstra queries, kept in step with edits
+    PathTreeCache& pathTrees() { return treeCache; }
+
+    // Draw all edges through one EdgeLayerItem instead of one item each
+    void setEdgeLayerEnabled(bool enabled);
+    bool edgeLayerEnabled() const { return edgeLayer != nullptr; }
+
+    // Sets staticInformation::lodEnabled and passes it on to the edge layer
+    void setLevelOfDetailEnabled(bool enabled);
+
+    // Converts every item to or from compact labels (staticInformation::compactItems)
+    void setCompactItems(bool enabled);
+
+    // Called by NodeItem when it moves. Connected edges are queued and
+    // recomputed together once control returns to the event loop, so a
+    // drag of many selected nodes costs one geometry pass per frame.
+    void nodeMoved(NodeItem* node);
+    // Moves every node to the given top-left coordinates (GraphModel
+    // convention); the arrays are indexed by node id.
+    void setNodePositions(const std::vector<double>& xs, const std::vector<double>& ys);
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
 
 private:
+    void attachToLayer(EdgeItem* edge);
+    // Replaces the items not flagged in nodeGone / edgeGone (indexed by
+    // id) with copies that keep their position, size, pens, flags and
+    // selection, after one QGraphicsScene::clear(). Removing many items
+    // one at a time costs a linear search of the scene's lists each.
+    void rebuildItems(const std::vector<char>& nodeGone, const std::vector<char>& edgeGone);
+    void flushEdgeGeometry();
+    // Edge under the cursor, whether drawn as an item or by the edge layer
+    EdgeItem* edgeAt(const QPointF& scenePos) const;
+
     StateMouse* stateMouse;
     QGraphicsLineItem* tempEdge;
     NodeItem* startNode;
+
+    QVector<NodeItem*> nodeItems;
+    QVector<EdgeItem*> edgeItems;
+    LabelIndex labels;
+    NodeGridIndex grid;
+    QSharedPointer<const GraphModel> cachedModel;
+    bool modelDirty = true;
+    quint64 revision = 0;
+    PathTreeCache treeCache;
+    EdgeLayerItem* edgeLayer = nullptr;
+    QVector<EdgeItem*> movedEdges;
+    bool flushPending = false;
+};
+
+// View with mouse-wheel zoom around the cursor
+class GraphView : public QGraphicsView {
+public:
+    GraphView(QGraphicsScene* scene, QWidget* parent = nullptr) : QGraphicsView(scene, parent) {
+        setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+    }
+    // Frame time, items painted, last query and peak memory in the corner
+    void setOverlayEnabled(bool enabled);
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void drawForeground(QPainter* painter, const QRectF& rect) override;
+    void wheelEvent(QWheelEvent* event) override {
+        qreal factor = std::pow(1.0015, event->angleDelta().y());
+        scale(factor, factor);
+        event->accept();
+    }
+private:
+    bool overlay = false;
+    ViewportUpdateMode updateMode = MinimalViewportUpdate;
 };
 
 class Graph : public QWidget {
@@ -206,10 +526,36 @@ public:
     }
     void exportGraph();
     void importGraph();
+    void convertGraph();
+    void saveImage();
+    void computeDistanceMatrix();
+    void buildHierarchy();
 private:
+    void startPathQuery(const QString& name, PathQuery query);
+    void searchNode(const QString& text);
+    void showPathStats(const QString& algorithm, const PathResult& path, qint64 elapsedMs);
+
     GraphScene *scene;
-    QGraphicsView *view;
+    GraphView *view;
     StateMouse* stateMouse;
+    QLabel* lblStats;
+    PathQueryRunner* pathRunner;
+    QString queryName;
+    quint64 queryRevision = 0;
+    LayoutRunner* layoutRunner;
+    quint64 layoutRevision = 0;
+    // Contraction hierarchy for the topology at hierarchyRevision; stale
+    // once the scene revision moves on
+    QSharedPointer<const ContractionHierarchy> hierarchy;
+    quint64 hierarchyRevision = 0;
+    QPushButton* btnHierarchy;
+    // Step replay of the last recorded query
+    QCheckBox* checkRecord;
+    TracePlayer* tracePlayer;
+    QSlider* sliderTrace;
+    quint64 traceRevision = 0;
+    PathResult tracePath;
+    QColor traceColor;
 };
 
 
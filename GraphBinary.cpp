@@ -0,0 +1,323 @@
+#include "GraphIO.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <cstring>
+
+// Binary graph file (.gvb), little-endian, every section 8-byte aligned:
+//
+//   Header      64 bytes, see BinaryHeader
+//   Node table  nodeCount x { f64 x, f64 y, u32 color, u32 labelOffset, u32 labelLength, u32 pad }
+//   Offsets     u32[nodeCount + 1]   CSR row starts into the edge arrays
+//   Targets     u32[edgeCount]
+//   Weights     f64[edgeCount]
+//   String pool UTF-8 label bytes
+//
+// The checksum is CRC-32 over everything after the header, so a truncated
+// or corrupted file is rejected before any of it reaches the scene.
+
+namespace {
+
+const char kMagic[8] = {'G', 'V', 'G', 'R', 'A', 'P', 'H', '\0'};
+const quint32 kBinaryVersion = 1;
+const int kHeaderSize = 64;
+const int kNodeRecordSize = 32;
+
+struct BinaryHeader {
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    quint64 nodeCount;
+    quint64 edgeCount;
+    quint32 nodeRadius;
+    quint32 nodeColor;
+    quint32 edgeColor;
+    quint32 flags;
+    quint64 stringPoolSize;
+    quint64 checksum;
+};
+static_assert(sizeof(BinaryHeader) == kHeaderSize, "BinaryHeader must stay 64 bytes");
+
+quint64 align8(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+struct Layout {
+    quint64 nodes, offsets, targets, weights, strings, total;
+
+    Layout(quint64 nodeCount, quint64 edgeCount, quint64 poolSize) {
+        nodes = kHeaderSize;
+        offsets = nodes + nodeCount * kNodeRecordSize;
+        targets = offsets + align8((nodeCount + 1) * 4);
+        weights = targets + align8(edgeCount * 4);
+        strings = weights + edgeCount * 8;
+        total = strings + align8(poolSize);
+    }
+};
+
+quint32 crc32(const uchar* data, quint64 size)
+{
+    static quint32 table[256];
+    static bool initialized = [] {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    Q_UNUSED(initialized);
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (quint64 i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+T readLE(const uchar* p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+double readDouble(const uchar* p)
+{
+    quint64 bits = qFromLittleEndian<quint64>(p);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeDouble(uchar* p, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, p);
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) *error = message;
+    return false;
+}
+
+}
+
+bool BinaryGraphFile::open(const QString &fileName, QString *error)
+{
+    GV_TRACE_SCOPE("BinaryGraphFile::open");
+    file.close();
+    base = nullptr;
+    nodes = edges = 0;
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail(error, file.errorString());
+
+    const qint64 size = file.size();
+    if (size < kHeaderSize) return fail(error, "Binary graph file is truncated");
+
+    const uchar* mapped = file.map(0, size);
+    if (!mapped) return fail(error, "Cannot map binary graph file: " + file.errorString());
+
+    BinaryHeader header;
+    std::memcpy(&header, mapped, kHeaderSize);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return fail(error, "Not a binary graph file");
+
+    const quint32 version = qFromLittleEndian(header.version);
+    if (version != kBinaryVersion) return fail(error, QString("Unsupported binary graph version %1").arg(version));
+
+    const quint64 nodeCount = qFromLittleEndian(header.nodeCount);
+    const quint64 edgeCount = qFromLittleEndian(header.edgeCount);
+    const quint64 poolSize = qFromLittleEndian(header.stringPoolSize);
+    if (nodeCount >= (1u << 31) || edgeCount >= (1u << 31) || poolSize > quint64(size)) {
+        return fail(error, "Binary graph file header is corrupted");
+    }
+
+    const Layout layout(nodeCount, edgeCount, poolSize);
+    if (layout.total != quint64(size)) return fail(error, "Binary graph file size does not match its header");
+
+    if (crc32(mapped + kHeaderSize, size - kHeaderSize) != quint32(qFromLittleEndian(header.checksum))) {
+        return fail(error, "Binary graph file checksum mismatch");
+    }
+
+    // Everything the accessors index with is checked here, once
+    for (quint64 i = 0; i < nodeCount; ++i) {
+        const uchar* record = mapped + layout.nodes + i * kNodeRecordSize;
+        const quint32 labelOffset = readLE<quint32>(record + 20);
+        const quint32 labelLength = readLE<quint32>(record + 24);
+        if (quint64(labelOffset) + labelLength > poolSize) return fail(error, "Binary graph label table is corrupted");
+    }
+    quint32 begin = readLE<quint32>(mapped + layout.offsets);
+    if (begin != 0) return fail(error, "Binary graph edge block is corrupted");
+    for (quint64 u = 0; u < nodeCount; ++u) {
+        const quint32 end = readLE<quint32>(mapped + layout.offsets + (u + 1) * 4);
+        if (end < begin || end > edgeCount) return fail(error, "Binary graph edge block is corrupted");
+        begin = end;
+    }
+    if (begin != edgeCount) return fail(error, "Binary graph edge block is corrupted");
+    for (quint64 slot = 0; slot < edgeCount; ++slot) {
+        if (readLE<quint32>(mapped + layout.targets + slot * 4) >= nodeCount) {
+            return fail(error, "Binary graph edge block is corrupted");
+        }
+    }
+
+    base = mapped;
+    nodeTable = base + layout.nodes;
+    rowStarts = base + layout.offsets;
+    slotTargets = base + layout.targets;
+    slotWeights = base + layout.weights;
+    pool = reinterpret_cast<const char*>(base + layout.strings);
+    nodes = int(nodeCount);
+    edges = int(edgeCount);
+    radius = int(qFromLittleEndian(header.nodeRadius));
+    defaultNodeColor = qFromLittleEndian(header.nodeColor);
+    defaultEdgeColor = qFromLittleEndian(header.edgeColor);
+    return true;
+}
+
+QString BinaryGraphFile::label(int node) const
+{
+    const uchar* record = nodeTable + quint64(node) * kNodeRecordSize;
+    const quint32 labelLength = readLE<quint32>(record + 24);
+    if (!labelLength) return QString();
+    return QString::fromUtf8(pool + readLE<quint32>(record + 20), int(labelLength));
+}
+
+GraphModel BinaryGraphFile::model() const
+{
+    GV_TRACE_SCOPE("BinaryGraphFile::model");
+    const double r = radius / 2;
+    std::vector<double> xs(nodes);
+    std::vector<double> ys(nodes);
+    for (int u = 0; u < nodes; ++u) {
+        const uchar* record = nodeTable + quint64(u) * kNodeRecordSize;
+        xs[u] = readDouble(record) - r;
+        ys[u] = readDouble(record + 8) - r;
+    }
+
+    // The file is already CSR; on little-endian hosts these are plain copies
+    std::vector<int> offsets(nodes + 1);
+    std::vector<int> targets(edges);
+    std::vector<double> weights(edges);
+    qFromLittleEndian<quint32>(rowStarts, nodes + 1, offsets.data());
+    qFromLittleEndian<quint32>(slotTargets, edges, targets.data());
+    qFromLittleEndian<quint64>(slotWeights, edges, weights.data());
+    return GraphModel(std::move(xs), std::move(ys), std::move(offsets), std::move(targets), std::move(weights));
+}
+
+void BinaryGraphFile::decode(GraphData &data) const
+{
+    data = GraphData();
+    data.nodeRadius = radius;
+    data.nodeColor = defaultNodeColor;
+    data.edgeColor = defaultEdgeColor;
+
+    data.nodes.resize(nodes);
+    for (int i = 0; i < nodes; ++i) {
+        const uchar* record = nodeTable + quint64(i) * kNodeRecordSize;
+        GraphData::Node& node = data.nodes[i];
+        node.x = readDouble(record);
+        node.y = readDouble(record + 8);
+        node.color = readLE<quint32>(record + 16);
+        node.label = label(i);
+    }
+
+    data.edges.resize(edges);
+    for (int u = 0; u < nodes; ++u) {
+        const int end = int(readLE<quint32>(rowStarts + quint64(u + 1) * 4));
+        for (int slot = int(readLE<quint32>(rowStarts + quint64(u) * 4)); slot < end; ++slot) {
+            data.edges[slot] = {u, int(readLE<quint32>(slotTargets + quint64(slot) * 4)),
+                                readDouble(slotWeights + quint64(slot) * 8)};
+        }
+    }
+}
+
+namespace GraphIO {
+
+bool isBinaryFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    char magic[sizeof(kMagic)];
+    return file.read(magic, sizeof(magic)) == qint64(sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+bool readBinary(const QString &fileName, GraphData &data, QString *error)
+{
+    GV_TRACE_SCOPE("GraphIO::readBinary");
+    BinaryGraphFile file;
+    if (!file.open(fileName, error)) return false;
+    file.decode(data);
+    return true;
+}
+
+bool writeBinary(QIODevice *device, const GraphData &data, QString *error)
+{
+    GV_TRACE_SCOPE("GraphIO::writeBinary");
+    const quint64 nodeCount = data.nodes.size();
+    const quint64 edgeCount = data.edges.size();
+
+    if (nodeCount >= (1u << 31) || edgeCount >= (1u << 31)) return fail(error, "Graph is too large for the binary format");
+
+    std::vector<QByteArray> labels(nodeCount);
+    quint64 poolSize = 0;
+    for (quint64 i = 0; i < nodeCount; ++i) {
+        labels[i] = data.nodes[i].label.toUtf8();
+        poolSize += labels[i].size();
+    }
+    // Label offsets and lengths are u32
+    if (poolSize > 0xFFFFFFFFu) return fail(error, "Node labels exceed the 4 GiB binary string pool");
+
+    const Layout layout(nodeCount, edgeCount, poolSize);
+    QByteArray bytes(qsizetype(layout.total), '\0');
+    uchar* base = reinterpret_cast<uchar*>(bytes.data());
+
+    // Node table and string pool
+    quint64 poolCursor = 0;
+    for (quint64 i = 0; i < nodeCount; ++i) {
+        const GraphData::Node& node = data.nodes[i];
+        uchar* record = base + layout.nodes + i * kNodeRecordSize;
+        writeDouble(record, node.x);
+        writeDouble(record + 8, node.y);
+        qToLittleEndian<quint32>(node.color, record + 16);
+        qToLittleEndian<quint32>(quint32(poolCursor), record + 20);
+        qToLittleEndian<quint32>(quint32(labels[i].size()), record + 24);
+        std::memcpy(base + layout.strings + poolCursor, labels[i].constData(), labels[i].size());
+        poolCursor += labels[i].size();
+    }
+
+    // CSR edge block, edges grouped by source with a counting sort
+    std::vector<quint32> rowStart(nodeCount + 1, 0);
+    for (const GraphData::Edge& edge : data.edges) rowStart[edge.source + 1]++;
+    for (quint64 u = 0; u < nodeCount; ++u) rowStart[u + 1] += rowStart[u];
+    for (quint64 u = 0; u <= nodeCount; ++u) qToLittleEndian<quint32>(rowStart[u], base + layout.offsets + u * 4);
+
+    std::vector<quint32> cursor(rowStart.begin(), rowStart.end() - 1);
+    for (const GraphData::Edge& edge : data.edges) {
+        const quint32 slot = cursor[edge.source]++;
+        qToLittleEndian<quint32>(quint32(edge.target), base + layout.targets + quint64(slot) * 4);
+        writeDouble(base + layout.weights + quint64(slot) * 8, edge.weight);
+    }
+
+    BinaryHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = qToLittleEndian(kBinaryVersion);
+    header.headerSize = qToLittleEndian(quint32(kHeaderSize));
+    header.nodeCount = qToLittleEndian(nodeCount);
+    header.edgeCount = qToLittleEndian(edgeCount);
+    header.nodeRadius = qToLittleEndian(quint32(data.nodeRadius));
+    header.nodeColor = qToLittleEndian(data.nodeColor);
+    header.edgeColor = qToLittleEndian(data.edgeColor);
+    header.flags = 0;
+    header.stringPoolSize = qToLittleEndian(poolSize);
+    header.checksum = qToLittleEndian(quint64(crc32(base + kHeaderSize, layout.total - kHeaderSize)));
+    std::memcpy(base, &header, kHeaderSize);
+
+    if (device->write(bytes) != bytes.size()) return fail(error, device->errorString());
+    return true;
+}
+
+}
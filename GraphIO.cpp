@@ -0,0 +1,388 @@
+#include "GraphIO.h"
+#include "JsonStreamReader.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLocale>
+#include <QPair>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+const int kJsonVersion = 2;
+const int kWriteChunk = 1 << 20;
+
+struct LegacyEdge {
+    double startX, startY, endX, endY, weight;
+};
+
+// Shortest JSON records: "{}," for a node, "[0,0,0]," for an edge
+const qint64 kMinNodeBytes = 3;
+const qint64 kMinEdgeBytes = 8;
+
+// Counts in the file are only hints; never trust them with an allocation.
+// No more records can follow than the rest of the device has room for,
+// and a sequential device (no size) gets no reservation at all.
+size_t sizeHint(double count, const QIODevice* device, qint64 minRecordBytes)
+{
+    const qint64 remaining = device->isSequential() ? 0 : device->size() - device->pos();
+    const double fit = double(qMax<qint64>(0, remaining) / minRecordBytes);
+    return count > 0 ? size_t(std::min({count, fit, 1e8})) : 0;
+}
+
+// Casting a NaN or out-of-range double to int is undefined, so ids and
+// other integers from the file are checked before they are converted
+bool toInt(double value, int& result)
+{
+    if (!(value >= INT_MIN && value <= INT_MAX) || std::trunc(value) != value) return false;
+    result = int(value);
+    return true;
+}
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+void appendJsonString(QByteArray& out, const QString& value)
+{
+    out.append('"');
+    const QByteArray utf8 = value.toUtf8();
+    for (char c : utf8) {
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uchar(c) < 0x20) {
+                out.append("\\u00");
+                out.append("0123456789abcdef"[(c >> 4) & 0xF]);
+                out.append("0123456789abcdef"[c & 0xF]);
+            } else {
+                out.append(c);
+            }
+        }
+    }
+    out.append('"');
+}
+
+bool readNode(JsonStreamReader& reader, GraphData::Node& node, int& id)
+{
+    for (auto t = reader.next(); t != JsonStreamReader::EndObject; t = reader.next()) {
+        if (t != JsonStreamReader::Name) return false;
+        const QByteArray key = reader.utf8();
+        if (key == "x") {
+            if (reader.next() != JsonStreamReader::Number) return false;
+            node.x = reader.number();
+        } else if (key == "y") {
+            if (reader.next() != JsonStreamReader::Number) return false;
+            node.y = reader.number();
+        } else if (key == "id") {
+            if (reader.next() != JsonStreamReader::Number || !toInt(reader.number(), id)) return false;
+        } else if (key == "color") {
+            if (reader.next() != JsonStreamReader::String) return false;
+            node.color = GraphIO::parseColor(reader.utf8(), node.color);
+        } else if (key == "label") {
+            if (reader.next() != JsonStreamReader::String) return false;
+            node.label = reader.string();
+        } else {
+            reader.skipValue();
+        }
+    }
+    return true;
+}
+
+bool readLegacyEdge(JsonStreamReader& reader, LegacyEdge& edge)
+{
+    edge = {0, 0, 0, 0, 1.0};
+    for (auto t = reader.next(); t != JsonStreamReader::EndObject; t = reader.next()) {
+        if (t != JsonStreamReader::Name) return false;
+        const QByteArray key = reader.utf8();
+        double* field = key == "start_x" ? &edge.startX
+                      : key == "start_y" ? &edge.startY
+                      : key == "end_x"   ? &edge.endX
+                      : key == "end_y"   ? &edge.endY
+                      : key == "weight"  ? &edge.weight
+                                         : nullptr;
+        if (!field) {
+            reader.skipValue();
+            continue;
+        }
+        if (reader.next() != JsonStreamReader::Number) return false;
+        *field = reader.number();
+    }
+    return true;
+}
+
+bool readEdgeTriple(JsonStreamReader& reader, GraphData::Edge& edge)
+{
+    double values[3] = {0, 0, 1.0};
+    int count = 0;
+    for (auto t = reader.next(); t != JsonStreamReader::EndArray; t = reader.next()) {
+        if (t != JsonStreamReader::Number || count == 3) return false;
+        values[count++] = reader.number();
+    }
+    if (count < 2) return false;
+    edge.weight = values[2];
+    return toInt(values[0], edge.source) && toInt(values[1], edge.target);
+}
+
+}
+
+namespace GraphIO {
+
+QByteArray colorName(quint32 argb)
+{
+    static const char hex[] = "0123456789abcdef";
+    QByteArray name("#000000");
+    for (int i = 0; i < 6; ++i) {
+        name[1 + i] = hex[(argb >> (20 - 4 * i)) & 0xF];
+    }
+    return name;
+}
+
+quint32 parseColor(const QByteArray &name, quint32 fallback)
+{
+    if (name.size() != 7 || name[0] != '#') return fallback;
+    bool ok = false;
+    quint32 rgb = name.mid(1).toUInt(&ok, 16);
+    return ok ? (0xff000000u | rgb) : fallback;
+}
+
+bool readJson(QIODevice *device, GraphData &data, QString *error)
+{
+    GV_TRACE_SCOPE("GraphIO::readJson");
+    data = GraphData();
+    JsonStreamReader reader(device);
+
+    std::vector<int> fileIds;
+    std::vector<LegacyEdge> legacyEdges;
+    bool idsAreIndices = true;
+
+    auto malformed = [&](const char* what) {
+        setError(error, reader.hasError() ? reader.errorString() : QString("Malformed %1").arg(what));
+        return false;
+    };
+
+    if (reader.next() != JsonStreamReader::BeginObject) return malformed("document");
+
+    for (auto t = reader.next(); t != JsonStreamReader::EndObject; t = reader.next()) {
+        if (t != JsonStreamReader::Name) return malformed("document");
+        const QByteArray key = reader.utf8();
+
+        if (key == "version") {
+            int version = 0;
+            if (reader.next() != JsonStreamReader::Number || !toInt(reader.number(), version)) return malformed("version");
+            if (version > kJsonVersion) {
+                setError(error, QString("Unsupported graph file version %1").arg(version));
+                return false;
+            }
+        } else if (key == "nodeRadius") {
+            if (reader.next() != JsonStreamReader::Number || !toInt(reader.number(), data.nodeRadius)) {
+                return malformed("nodeRadius");
+            }
+        } else if (key == "nodeColor" || key == "edgeColor") {
+            if (reader.next() != JsonStreamReader::String) return malformed("color");
+            quint32& color = key == "nodeColor" ? data.nodeColor : data.edgeColor;
+            color = parseColor(reader.utf8(), color);
+        } else if (key == "nodeCount") {
+            // Size hints let the arrays be allocated once
+            if (reader.next() != JsonStreamReader::Number) return malformed("nodeCount");
+            const size_t nodes = sizeHint(reader.number(), device, kMinNodeBytes);
+            data.nodes.reserve(nodes);
+            fileIds.reserve(nodes);
+        } else if (key == "edgeCount") {
+            if (reader.next() != JsonStreamReader::Number) return malformed("edgeCount");
+            data.edges.reserve(sizeHint(reader.number(), device, kMinEdgeBytes));
+        } else if (key == "nodes") {
+            if (reader.next() != JsonStreamReader::BeginArray) return malformed("nodes");
+            for (auto n = reader.next(); n != JsonStreamReader::EndArray; n = reader.next()) {
+                if (n != JsonStreamReader::BeginObject) return malformed("node");
+                GraphData::Node node;
+                node.color = data.nodeColor;
+                int id = int(data.nodes.size());
+                if (!readNode(reader, node, id)) return malformed("node");
+                idsAreIndices = idsAreIndices && id == int(data.nodes.size());
+                fileIds.push_back(id);
+                data.nodes.push_back(std::move(node));
+            }
+        } else if (key == "edges") {
+            if (reader.next() != JsonStreamReader::BeginArray) return malformed("edges");
+            for (auto e = reader.next(); e != JsonStreamReader::EndArray; e = reader.next()) {
+                if (e == JsonStreamReader::BeginArray) {
+                    GraphData::Edge edge;
+                    if (!readEdgeTriple(reader, edge)) return malformed("edge");
+                    data.edges.push_back(edge);
+                } else if (e == JsonStreamReader::BeginObject) {
+                    LegacyEdge edge;
+                    if (!readLegacyEdge(reader, edge)) return malformed("edge");
+                    legacyEdges.push_back(edge);
+                } else {
+                    return malformed("edge");
+                }
+            }
+        } else {
+            reader.skipValue();
+        }
+        if (reader.hasError()) return malformed("document");
+    }
+
+    const int nodeCount = int(data.nodes.size());
+
+    // v2: map file ids to positions, dropping edges to unknown nodes
+    if (!idsAreIndices) {
+        QHash<int, int> indexOfId;
+        indexOfId.reserve(nodeCount);
+        for (int i = 0; i < nodeCount; ++i) indexOfId.insert(fileIds[i], i);
+        for (GraphData::Edge& edge : data.edges) {
+            edge.source = indexOfId.value(edge.source, -1);
+            edge.target = indexOfId.value(edge.target, -1);
+        }
+    }
+
+    // v1: endpoints are identified by the node coordinates as written
+    if (!legacyEdges.empty()) {
+        QHash<QPair<double, double>, int> indexOfPosition;
+        indexOfPosition.reserve(nodeCount);
+        for (int i = 0; i < nodeCount; ++i) {
+            indexOfPosition.insert(qMakePair(data.nodes[i].x, data.nodes[i].y), i);
+        }
+        for (const LegacyEdge& legacy : legacyEdges) {
+            int source = indexOfPosition.value(qMakePair(legacy.startX, legacy.startY), -1);
+            int target = indexOfPosition.value(qMakePair(legacy.endX, legacy.endY), -1);
+            data.edges.push_back({source, target, legacy.weight});
+        }
+    }
+
+    auto invalid = [nodeCount](const GraphData::Edge& edge) {
+        return edge.source < 0 || edge.source >= nodeCount || edge.target < 0 || edge.target >= nodeCount;
+    };
+    data.edges.erase(std::remove_if(data.edges.begin(), data.edges.end(), invalid), data.edges.end());
+    return true;
+}
+
+bool writeJson(QIODevice *device, const GraphData &data, QString *error)
+{
+    GV_TRACE_SCOPE("GraphIO::writeJson");
+    QByteArray out;
+    out.reserve(kWriteChunk + 4096);
+    auto flush = [&](bool force) {
+        if (!force && out.size() < kWriteChunk) return true;
+        if (device->write(out) != out.size()) {
+            setError(error, device->errorString());
+            return false;
+        }
+        out.clear();
+        return true;
+    };
+
+    out += "{\n    \"version\": " + QByteArray::number(kJsonVersion);
+    out += ",\n    \"nodeRadius\": " + QByteArray::number(data.nodeRadius);
+    out += ",\n    \"nodeColor\": \"" + colorName(data.nodeColor) + "\"";
+    out += ",\n    \"edgeColor\": \"" + colorName(data.edgeColor) + "\"";
+    out += ",\n    \"nodeCount\": " + QByteArray::number(qint64(data.nodes.size()));
+    out += ",\n    \"edgeCount\": " + QByteArray::number(qint64(data.edges.size()));
+
+    out += ",\n    \"nodes\": [";
+    for (size_t i = 0; i < data.nodes.size(); ++i) {
+        const GraphData::Node& node = data.nodes[i];
+        out += i ? ",\n        {\"id\": " : "\n        {\"id\": ";
+        out += QByteArray::number(qint64(i));
+        out += ", \"x\": " + number(node.x);
+        out += ", \"y\": " + number(node.y);
+        out += ", \"color\": \"" + colorName(node.color) + "\", \"label\": ";
+        appendJsonString(out, node.label);
+        out += '}';
+        if (!flush(false)) return false;
+    }
+
+    out += "\n    ],\n    \"edges\": [";
+    for (size_t i = 0; i < data.edges.size(); ++i) {
+        const GraphData::Edge& edge = data.edges[i];
+        out += i ? ",\n        [" : "\n        [";
+        out += QByteArray::number(edge.source) + ", " + QByteArray::number(edge.target) + ", " + number(edge.weight);
+        out += ']';
+        if (!flush(false)) return false;
+    }
+    out += "\n    ]\n}\n";
+    return flush(true);
+}
+
+bool load(const QString &fileName, GraphData &data, QString *error)
+{
+    if (isBinaryFile(fileName)) return readBinary(fileName, data, error);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return readJson(&file, data, error);
+}
+
+bool save(const QString &fileName, const GraphData &data, QString *error)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+    bool binary = QFileInfo(fileName).suffix().compare("gvb", Qt::CaseInsensitive) == 0;
+    if (!(binary ? writeBinary(&file, data, error) : writeJson(&file, data, error))) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool convert(const QString &inputFile, const QString &outputFile, QString *error)
+{
+    GraphData data;
+    return load(inputFile, data, error) && save(outputFile, data, error);
+}
+
+GraphModel toModel(const GraphData &data)
+{
+    // Integer half radius, as loadGraph sizes the node rects
+    const double r = data.nodeRadius / 2;
+    std::vector<double> xs(data.nodes.size());
+    std::vector<double> ys(data.nodes.size());
+    for (size_t u = 0; u < data.nodes.size(); ++u) {
+        xs[u] = data.nodes[u].x - r;
+        ys[u] = data.nodes[u].y - r;
+    }
+    std::vector<GraphModel::Edge> edges(data.edges.size());
+    for (size_t id = 0; id < data.edges.size(); ++id) {
+        edges[id] = {data.edges[id].source, data.edges[id].target, data.edges[id].weight};
+    }
+    return GraphModel(std::move(xs), std::move(ys), std::move(edges));
+}
+
+QByteArray csvField(const QString &text)
+{
+    QByteArray field = text.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        field.replace("\"", "\"\"");
+        field = '"' + field + '"';
+    }
+    return field;
+}
+
+}
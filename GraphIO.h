@@ -0,0 +1,108 @@
+#ifndef GRAPHIO_H
+#define GRAPHIO_H
+
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+
+#include <vector>
+
+#include "GraphModel.h"
+
+// Plain in-memory form of a graph file, independent of the scene.
+// Node positions are centers; colors are 0xAARRGGBB.
+struct GraphData {
+    struct Node {
+        double x = 0;
+        double y = 0;
+        quint32 color = 0xffff0000;
+        QString label;
+    };
+    struct Edge {
+        int source;
+        int target;
+        double weight;
+    };
+
+    int nodeRadius = 30;
+    quint32 nodeColor = 0xffff0000;
+    quint32 edgeColor = 0xff0000ff;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+};
+
+// A .gvb file mapped into memory. open() checks the header, checksum,
+// edge block and label table once; after that the model is built straight
+// from the mapped CSR arrays and labels are decoded only when asked for.
+// The mapping lives as long as the object.
+class BinaryGraphFile {
+public:
+    bool open(const QString& fileName, QString* error = nullptr);
+
+    int nodeCount() const { return nodes; }
+    int edgeCount() const { return edges; }
+    int nodeRadius() const { return radius; }
+    quint32 nodeColor() const { return defaultNodeColor; }
+    quint32 edgeColor() const { return defaultEdgeColor; }
+    QString label(int node) const;
+
+    // Positions are node rect top-left, as in GraphScene::model()
+    GraphModel model() const;
+    // Everything decoded, for GraphScene::loadGraph
+    void decode(GraphData& data) const;
+
+private:
+    QFile file;
+    const uchar* base = nullptr;
+    const uchar* nodeTable = nullptr;
+    const uchar* rowStarts = nullptr;
+    const uchar* slotTargets = nullptr;
+    const uchar* slotWeights = nullptr;
+    const char* pool = nullptr;
+    int nodes = 0;
+    int edges = 0;
+    int radius = 30;
+    quint32 defaultNodeColor = 0;
+    quint32 defaultEdgeColor = 0;
+};
+
+namespace GraphIO {
+
+// JSON, schema v2:
+//   { "version": 2, "nodeRadius": .., "nodeColor": "#rrggbb", "edgeColor": "#rrggbb",
+//     "nodeCount": n, "edgeCount": m,
+//     "nodes": [ {"id": 0, "x": .., "y": .., "color": "#rrggbb", "label": ".."}, .. ],
+//     "edges": [ [src, dst, weight], .. ] }
+//
+// Reading is streamed and also accepts v1 files, whose edges reference
+// their endpoints by start_x/start_y/end_x/end_y.
+bool readJson(QIODevice* device, GraphData& data, QString* error = nullptr);
+bool writeJson(QIODevice* device, const GraphData& data, QString* error = nullptr);
+
+// Binary (.gvb): header, node table, CSR edge block and string pool,
+// loaded through BinaryGraphFile and written with one sequential write.
+// See GraphBinary.cpp for the layout. Edges come back grouped by source.
+// Writing fails if the labels take more than 4 GiB.
+bool isBinaryFile(const QString& fileName);
+bool readBinary(const QString& fileName, GraphData& data, QString* error = nullptr);
+bool writeBinary(QIODevice* device, const GraphData& data, QString* error = nullptr);
+
+// Format is picked from the file magic on load and from the suffix on
+// save (".gvb" for binary, JSON otherwise).
+bool load(const QString& fileName, GraphData& data, QString* error = nullptr);
+bool save(const QString& fileName, const GraphData& data, QString* error = nullptr);
+bool convert(const QString& inputFile, const QString& outputFile, QString* error = nullptr);
+
+QByteArray colorName(quint32 argb);
+quint32 parseColor(const QByteArray& name, quint32 fallback);
+
+// Positions are node rect top-left, as in GraphScene::model() after
+// GraphScene::loadGraph(data)
+GraphModel toModel(const GraphData& data);
+
+// UTF-8, quoted when it holds a comma, quote or line break (RFC 4180)
+QByteArray csvField(const QString& text);
+
+}
+
+#endif // GRAPHIO_H
@@ -0,0 +1,80 @@
+#include "GraphModel.h"
+
+#include <utility>
+
+GraphModel::GraphModel(std::vector<double> xs, std::vector<double> ys, std::vector<Edge> edges)
+    : posX(std::move(xs)), posY(std::move(ys)), edgeList(std::move(edges)) {
+    const int n = nodeCount();
+    const int m = edgeCount();
+
+    // Counting sort of the edges by source node.
+    offsets.assign(n + 1, 0);
+    for (const Edge& e : edgeList) {
+        offsets[e.source + 1]++;
+        if (e.weight < 0) negativeWeight = true;
+    }
+    for (int u = 0; u < n; ++u) {
+        offsets[u + 1] += offsets[u];
+    }
+
+    targets.resize(m);
+    weights.resize(m);
+    edgeIds.resize(m);
+
+    std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+    for (int id = 0; id < m; ++id) {
+        const Edge& e = edgeList[id];
+        int slot = cursor[e.source]++;
+        targets[slot] = e.target;
+        weights[slot] = e.weight;
+        edgeIds[slot] = id;
+    }
+
+    buildReverse();
+}
+
+GraphModel::GraphModel(std::vector<double> xs, std::vector<double> ys, std::vector<int> outOffsets,
+                       std::vector<int> outTargets, std::vector<double> outWeights)
+    : posX(std::move(xs)), posY(std::move(ys)), offsets(std::move(outOffsets)),
+      targets(std::move(outTargets)), weights(std::move(outWeights)) {
+    const int n = nodeCount();
+    const int m = int(targets.size());
+
+    edgeList.resize(m);
+    edgeIds.resize(m);
+    for (int u = 0; u < n; ++u) {
+        for (int slot = offsets[u]; slot < offsets[u + 1]; ++slot) {
+            edgeList[slot] = {u, targets[slot], weights[slot]};
+            edgeIds[slot] = slot;
+            if (weights[slot] < 0) negativeWeight = true;
+        }
+    }
+    buildReverse();
+}
+
+void GraphModel::buildReverse() {
+    // Counting sort again, keyed by target, for the reverse adjacency.
+    const int n = nodeCount();
+    const int m = edgeCount();
+
+    inOffsets.assign(n + 1, 0);
+    for (const Edge& e : edgeList) {
+        inOffsets[e.target + 1]++;
+    }
+    for (int v = 0; v < n; ++v) {
+        inOffsets[v + 1] += inOffsets[v];
+    }
+
+    inSources.resize(m);
+    inWeights.resize(m);
+    inEdgeIds.resize(m);
+
+    std::vector<int> cursor(inOffsets.begin(), inOffsets.end() - 1);
+    for (int id = 0; id < m; ++id) {
+        const Edge& e = edgeList[id];
+        int slot = cursor[e.target]++;
+        inSources[slot] = e.source;
+        inWeights[slot] = e.weight;
+        inEdgeIds[slot] = id;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef GRAPHMODEL_H
+#define GRAPHMODEL_H
+
+#include <vector>
+
+// Immutable, compact copy of the graph topology.
+//
+// Nodes and edges are addressed by dense integer IDs (0..n-1) that mirror
+// NodeItem::id / EdgeItem::id in the scene. Out-edges are stored in
+// compressed sparse row form: the out-edges of node u occupy the slots
+// [outBegin(u), outEnd(u)) of the target/weight/edgeId arrays, so
+// algorithms walk contiguous memory instead of the item tree. In-edges
+// are kept the same way in [inBegin(v), inEnd(v)) for backward searches.
+class GraphModel {
+public:
+    struct Edge {
+        int source;
+        int target;
+        double weight;
+    };
+
+    GraphModel() = default;
+    GraphModel(std::vector<double> xs, std::vector<double> ys, std::vector<Edge> edges);
+    // Out-edges already in CSR form, e.g. straight from a .gvb file; the
+    // edge ids are the slots. `outOffsets` has nodeCount + 1 entries.
+    GraphModel(std::vector<double> xs, std::vector<double> ys, std::vector<int> outOffsets,
+               std::vector<int> outTargets, std::vector<double> outWeights);
+
+    int nodeCount() const { return int(posX.size()); }
+    int edgeCount() const { return int(edgeList.size()); }
+
+    int outBegin(int u) const { return offsets[u]; }
+    int outEnd(int u) const { return offsets[u + 1]; }
+    int target(int slot) const { return targets[slot]; }
+    double weight(int slot) const { return weights[slot]; }
+    int edgeId(int slot) const { return edgeIds[slot]; }
+
+    int inBegin(int v) const { return inOffsets[v]; }
+    int inEnd(int v) const { return inOffsets[v + 1]; }
+    int inSource(int slot) const { return inSources[slot]; }
+    double inWeight(int slot) const { return inWeights[slot]; }
+    int inEdgeId(int slot) const { return inEdgeIds[slot]; }
+
+    const Edge& edge(int id) const { return edgeList[id]; }
+    // Dijkstra-based searches and heuristics are only exact without these
+    bool hasNegativeWeight() const { return negativeWeight; }
+    double x(int u) const { return posX[u]; }
+    double y(int u) const { return posY[u]; }
+
+private:
+    void buildReverse();
+
+    std::vector<double> posX;
+    std::vector<double> posY;
+    std::vector<Edge> edgeList;
+    bool negativeWeight = false;
+
+    std::vector<int> offsets;
+    std::vector<int> targets;
+    std::vector<double> weights;
+    std::vector<int> edgeIds;
+
+    std::vector<int> inOffsets;
+    std::vector<int> inSources;
+    std::vector<double> inWeights;
+    std::vector<int> inEdgeIds;
+};
+
+#endif // GRAPHMODEL_H
@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,13 +8,13 @@ CONFIG += c++17 qt
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(engine.pri)
+
 SOURCES += \
-    Graph.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
-    Graph.h \
     mainwindow.h
 
 FORMS += \
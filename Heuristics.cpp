@@ -0,0 +1,81 @@
+#include "Heuristics.h"
+#include "ShortestPath.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+const double kInfinity = std::numeric_limits<double>::infinity();
+}
+
+EuclideanHeuristic::EuclideanHeuristic(const GraphModel& graph) : graph(graph), scale(kInfinity) {
+    for (int id = 0; id < graph.edgeCount(); ++id) {
+        const GraphModel::Edge& e = graph.edge(id);
+        double length = std::hypot(graph.x(e.target) - graph.x(e.source), graph.y(e.target) - graph.y(e.source));
+        if (length <= 0) {
+            if (e.weight < 0) scale = 0;
+            continue;
+        }
+        scale = std::min(scale, e.weight / length);
+    }
+    if (!(scale > 0) || scale == kInfinity) scale = 0;
+}
+
+double EuclideanHeuristic::estimate(int node, int target) const {
+    if (scale == 0) return 0;
+    return scale * std::hypot(graph.x(target) - graph.x(node), graph.y(target) - graph.y(node));
+}
+
+LandmarkHeuristic::LandmarkHeuristic(const GraphModel& graph, int landmarkCount) {
+    const int n = graph.nodeCount();
+    if (n == 0 || graph.hasNegativeWeight()) return;
+
+    // Farthest-point selection: each new landmark is the reachable node
+    // whose distance to the closest landmark chosen so far is largest.
+    std::vector<std::vector<double>> runs;
+    std::vector<double> closest(n, kInfinity);
+    ShortestPathEngine engine;
+
+    int next = 0;
+    for (int u = 1; u < n; ++u) {
+        if (graph.outEnd(u) - graph.outBegin(u) > graph.outEnd(next) - graph.outBegin(next)) next = u;
+    }
+
+    while (int(landmarkNodes.size()) < landmarkCount) {
+        std::vector<double> distances;
+        engine.oneToAll(graph, next, distances);
+        landmarkNodes.push_back(next);
+
+        int farthest = -1;
+        for (int v = 0; v < n; ++v) {
+            if (distances[v] < closest[v]) closest[v] = distances[v];
+            if (closest[v] == kInfinity) continue;
+            if (farthest < 0 || closest[v] > closest[farthest]) farthest = v;
+        }
+        runs.push_back(std::move(distances));
+
+        if (farthest < 0 || closest[farthest] == 0) break;
+        next = farthest;
+    }
+
+    k = int(landmarkNodes.size());
+    fromLandmark.resize(size_t(n) * k);
+    for (int l = 0; l < k; ++l) {
+        for (int v = 0; v < n; ++v) {
+            fromLandmark[size_t(v) * k + l] = runs[l][v];
+        }
+    }
+}
+
+double LandmarkHeuristic::estimate(int node, int target) const {
+    const double* fromNode = fromLandmark.data() + size_t(node) * k;
+    const double* fromTarget = fromLandmark.data() + size_t(target) * k;
+
+    double best = 0;
+    for (int l = 0; l < k; ++l) {
+        // Landmarks that cannot reach both nodes give no bound.
+        if (fromTarget[l] == kInfinity || fromNode[l] == kInfinity) continue;
+        best = std::max(best, fromTarget[l] - fromNode[l]);
+    }
+    return best;
+}
@@ -0,0 +1,59 @@
+#ifndef HEURISTICS_H
+#define HEURISTICS_H
+
+#include <vector>
+
+#include "GraphModel.h"
+
+enum HeuristicMode{
+    No_Heuristic,
+    Euclidean_Heuristic,
+    Landmark_Heuristic
+};
+
+// Lower bound on the remaining distance from a node to the target.
+// Implementations must be admissible and consistent for A* to stay exact,
+// and must be safe to call from several threads at once.
+class Heuristic {
+public:
+    virtual ~Heuristic() = default;
+    virtual double estimate(int node, int target) const = 0;
+};
+
+class ZeroHeuristic : public Heuristic {
+public:
+    double estimate(int, int) const override { return 0; }
+};
+
+// Straight-line distance between node positions, scaled by the smallest
+// weight-per-pixel ratio of any edge so it never overestimates. Falls back
+// to zero when some edge has a non-positive weight.
+class EuclideanHeuristic : public Heuristic {
+public:
+    explicit EuclideanHeuristic(const GraphModel& graph);
+    double estimate(int node, int target) const override;
+    double ratio() const { return scale; }
+
+private:
+    const GraphModel& graph;
+    double scale;
+};
+
+// ALT heuristic: distances from a few landmarks, picked by farthest-point
+// selection, are precomputed once per topology and reused across queries.
+// By the triangle inequality d(L,t) - d(L,v) <= d(v,t) for every landmark L.
+// The landmark runs use Dijkstra, so with a negative edge weight no
+// landmarks are picked and the estimate falls back to zero.
+class LandmarkHeuristic : public Heuristic {
+public:
+    LandmarkHeuristic(const GraphModel& graph, int landmarkCount = 8);
+    double estimate(int node, int target) const override;
+    const std::vector<int>& landmarks() const { return landmarkNodes; }
+
+private:
+    std::vector<int> landmarkNodes;
+    std::vector<double> fromLandmark;   // node-major: [node * k + landmark]
+    int k = 0;
+};
+
+#endif // HEURISTICS_H
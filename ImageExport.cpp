@@ -0,0 +1,402 @@
+#include "ImageExport.h"
+#include "Graph.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSvgGenerator>
+#include <QtEndian>
+
+#include <climits>
+#include <cmath>
+#include <zlib.h>
+
+namespace {
+
+const int kTileSize = 256;
+// Items covering more tiles than this are tested against every tile
+// instead of being entered into each cell
+const int kMaxItemCells = 256;
+// Room left for a label next to its anchor, in scene units
+const QSizeF kLabelExtent(80, 30);
+const qreal kTextMargin = 4;    // QGraphicsTextItem document margin
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) *error = message;
+    return false;
+}
+
+QRectF labelRect(const QPointF& pos)
+{
+    return QRectF(pos, kLabelExtent);
+}
+
+void drawLabel(QPainter& painter, const QPointF& pos, const QString& text)
+{
+    painter.drawText(QRectF(pos + QPointF(kTextMargin, kTextMargin), kLabelExtent),
+                     Qt::AlignLeft | Qt::AlignTop | Qt::TextDontClip, text);
+}
+
+// Same rules as EdgeItem::paint and NodeItem::paint for a given level of detail
+void paintEdge(QPainter& painter, const ImageSnapshot::Edge& edge, qreal lod)
+{
+    auto info = staticInformation::instance();
+    painter.setPen(lod < info->lodPoints ? QPen(edge.pen.color(), 0) : edge.pen);
+    painter.drawLine(edge.line);
+    if (lod < info->lodArrows) return;
+
+    painter.setBrush(edge.pen.color());
+    painter.drawPolygon(edge.arrowHead);
+    if (lod < info->lodLabels) return;
+
+    painter.setPen(Qt::black);
+    drawLabel(painter, edge.labelPos, edge.text);
+}
+
+void paintNode(QPainter& painter, const ImageSnapshot::Node& node, qreal lod)
+{
+    auto info = staticInformation::instance();
+    if (lod < info->lodPoints) {
+        QPen point(node.color, 3);
+        point.setCosmetic(true);
+        painter.setPen(point);
+        painter.drawPoint(node.rect.center());
+        return;
+    }
+    painter.setPen(node.pen);
+    painter.setBrush(node.color);
+    painter.drawEllipse(node.rect);
+    if (lod < info->lodLabels) return;
+
+    painter.setPen(Qt::black);
+    drawLabel(painter, node.labelPos, node.label);
+}
+
+QRectF edgeBounds(const ImageSnapshot::Edge& edge)
+{
+    const qreal extra = edge.pen.widthF() / 2 + 1;
+    return QRectF(edge.line.p1(), edge.line.p2()).normalized()
+        .united(edge.arrowHead.boundingRect())
+        .adjusted(-extra, -extra, extra, extra)
+        .united(labelRect(edge.labelPos));
+}
+
+QRectF nodeBounds(const ImageSnapshot::Node& node)
+{
+    const qreal extra = node.pen.widthF() / 2 + 1;
+    return node.rect.adjusted(-extra, -extra, extra, extra).united(labelRect(node.labelPos));
+}
+
+ImageSnapshot::Edge edgeOf(const EdgeItem* edge)
+{
+    const EdgeGeometry geometry = edge->geometry();
+    return {geometry.line, geometry.arrowHead, edge->edgePen(), geometry.labelPos, QString::number(edge->getWeight())};
+}
+
+ImageSnapshot::Node nodeOf(const NodeItem* node)
+{
+    // Nodes keep their rect in item coordinates; pos() is the drag offset
+    return {node->rect().translated(node->pos()), node->brush().color(), node->pen(), node->labelScenePos(), node->label};
+}
+
+// Items bucketed by the tiles they overlap, in CSR form. Edges first,
+// then nodes, so every tile paints in the same order as the whole image.
+class TileIndex {
+public:
+    TileIndex(const ImageSnapshot& snapshot, double scale, int columns, int rows)
+        : columns(columns), rows(rows) {
+        const double cell = kTileSize / scale;
+        const QPointF origin = snapshot.bounds.topLeft();
+        const int edgeCount = int(snapshot.edges.size());
+        const int itemCount = edgeCount + int(snapshot.nodes.size());
+
+        std::vector<QRect> spans(itemCount);
+        for (int item = 0; item < itemCount; ++item) {
+            const QRectF box = item < edgeCount ? edgeBounds(snapshot.edges[item])
+                                                : nodeBounds(snapshot.nodes[item - edgeCount]);
+            const int x0 = qBound(0, int(std::floor((box.left() - origin.x()) / cell)), columns - 1);
+            const int x1 = qBound(0, int(std::floor((box.right() - origin.x()) / cell)), columns - 1);
+            const int y0 = qBound(0, int(std::floor((box.top() - origin.y()) / cell)), rows - 1);
+            const int y1 = qBound(0, int(std::floor((box.bottom() - origin.y()) / cell)), rows - 1);
+            spans[item] = QRect(QPoint(x0, y0), QPoint(x1, y1));
+        }
+
+        offsets.assign(size_t(columns) * rows + 1, 0);
+        auto isWide = [](const QRect& span) { return qint64(span.width()) * span.height() > kMaxItemCells; };
+        for (int item = 0; item < itemCount; ++item) {
+            const QRect& span = spans[item];
+            if (isWide(span)) continue;
+            for (int y = span.top(); y <= span.bottom(); ++y) {
+                for (int x = span.left(); x <= span.right(); ++x) ++offsets[size_t(y) * columns + x + 1];
+            }
+        }
+        for (size_t cell = 1; cell < offsets.size(); ++cell) offsets[cell] += offsets[cell - 1];
+
+        items.resize(offsets.back());
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (int item = 0; item < itemCount; ++item) {
+            const QRect& span = spans[item];
+            if (isWide(span)) {
+                wide.push_back(item);
+                continue;
+            }
+            for (int y = span.top(); y <= span.bottom(); ++y) {
+                for (int x = span.left(); x <= span.right(); ++x) items[fill[size_t(y) * columns + x]++] = item;
+            }
+        }
+    }
+
+    int cellBegin(int x, int y) const { return offsets[size_t(y) * columns + x]; }
+    int cellEnd(int x, int y) const { return offsets[size_t(y) * columns + x + 1]; }
+    int item(int slot) const { return items[slot]; }
+    const std::vector<int>& wideItems() const { return wide; }
+
+private:
+    int columns;
+    int rows;
+    std::vector<int> offsets;
+    std::vector<int> items;
+    std::vector<int> wide;
+};
+
+// Minimal streaming PNG encoder: 8-bit RGB, Sub filter, one zlib
+// stream split over IDAT chunks as the output buffer fills.
+class PngWriter {
+public:
+    explicit PngWriter(QIODevice* device) : device(device), buffer(1 << 16) {}
+    ~PngWriter() { if (started) deflateEnd(&stream); }
+
+    bool begin(int width, int height) {
+        static const uchar signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        ok = device->write(reinterpret_cast<const char*>(signature), 8) == 8;
+
+        uchar header[13];
+        qToBigEndian<quint32>(quint32(width), header);
+        qToBigEndian<quint32>(quint32(height), header + 4);
+        header[8] = 8;      // bit depth
+        header[9] = 2;      // truecolor
+        header[10] = 0;     // deflate
+        header[11] = 0;     // adaptive filtering
+        header[12] = 0;     // no interlace
+        chunk("IHDR", header, sizeof(header));
+
+        rowBytes = size_t(width) * 3;
+        filtered.resize(rowBytes + 1);
+        stream = z_stream();
+        started = deflateInit(&stream, Z_DEFAULT_COMPRESSION) == Z_OK;
+        ok = ok && started;
+        stream.next_out = buffer.data();
+        stream.avail_out = uInt(buffer.size());
+        return ok;
+    }
+
+    bool writeRow(const uchar* rgb) {
+        filtered[0] = 1;    // Sub: each byte minus the same channel of the previous pixel
+        for (size_t i = 0; i < rowBytes; ++i) {
+            filtered[i + 1] = uchar(rgb[i] - (i >= 3 ? rgb[i - 3] : 0));
+        }
+        stream.next_in = filtered.data();
+        stream.avail_in = uInt(filtered.size());
+        while (ok && stream.avail_in > 0) {
+            ok = deflate(&stream, Z_NO_FLUSH) != Z_STREAM_ERROR;
+            if (stream.avail_out == 0) flushData();
+        }
+        return ok;
+    }
+
+    bool end() {
+        int status = Z_OK;
+        while (ok && status != Z_STREAM_END) {
+            status = deflate(&stream, Z_FINISH);
+            ok = status != Z_STREAM_ERROR;
+            if (stream.avail_out == 0 || status == Z_STREAM_END) flushData();
+        }
+        chunk("IEND", nullptr, 0);
+        return ok;
+    }
+
+private:
+    void flushData() {
+        const size_t size = buffer.size() - stream.avail_out;
+        if (size > 0) chunk("IDAT", buffer.data(), size);
+        stream.next_out = buffer.data();
+        stream.avail_out = uInt(buffer.size());
+    }
+
+    void chunk(const char* type, const uchar* data, size_t size) {
+        uchar length[4];
+        qToBigEndian<quint32>(quint32(size), length);
+        uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+        if (size > 0) crc = crc32(crc, data, uInt(size));
+        uchar trailer[4];
+        qToBigEndian<quint32>(quint32(crc), trailer);
+
+        ok = ok && device->write(reinterpret_cast<const char*>(length), 4) == 4
+                && device->write(type, 4) == 4
+                && (size == 0 || device->write(reinterpret_cast<const char*>(data), qint64(size)) == qint64(size))
+                && device->write(reinterpret_cast<const char*>(trailer), 4) == 4;
+    }
+
+    QIODevice* device;
+    std::vector<uchar> buffer;
+    std::vector<uchar> filtered;
+    size_t rowBytes = 0;
+    z_stream stream;
+    bool started = false;
+    bool ok = true;
+};
+
+}
+
+namespace ImageExport {
+
+ImageSnapshot snapshot(const GraphScene &scene)
+{
+    GV_TRACE_SCOPE("ImageExport::snapshot");
+    ImageSnapshot result;
+    result.nodes.reserve(scene.nodes().size());
+    result.edges.reserve(scene.edges().size());
+
+    QRectF bounds;
+    for (EdgeItem* edge : scene.edges()) {
+        result.edges.push_back(edgeOf(edge));
+        bounds |= edgeBounds(result.edges.back());
+    }
+    for (NodeItem* node : scene.nodes()) {
+        result.nodes.push_back(nodeOf(node));
+        bounds |= nodeBounds(result.nodes.back());
+    }
+    result.bounds = bounds;
+    result.font = scene.font();
+    return result;
+}
+
+bool writePng(const ImageSnapshot &snapshot, const QString &fileName, double scale, QString *error,
+              std::function<bool(int, int)> progress)
+{
+    GV_TRACE_SCOPE("ImageExport::writePng");
+    if (snapshot.bounds.isEmpty()) return fail(error, "The graph is empty.");
+
+    const double width = std::ceil(snapshot.bounds.width() * scale);
+    const double height = std::ceil(snapshot.bounds.height() * scale);
+    if (scale <= 0 || width > INT_MAX / 4 || height > INT_MAX) return fail(error, "The image would be too large.");
+
+    const int imageWidth = int(width);
+    const int imageHeight = int(height);
+    const int columns = (imageWidth + kTileSize - 1) / kTileSize;
+    const int rows = (imageHeight + kTileSize - 1) / kTileSize;
+    const TileIndex index(snapshot, scale, columns, rows);
+
+    auto info = staticInformation::instance();
+    const qreal lod = info->lodEnabled ? scale : 1.0;
+    const int edgeCount = int(snapshot.edges.size());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+    PngWriter png(&file);
+    if (!png.begin(imageWidth, imageHeight)) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+
+    std::vector<uchar> band(size_t(imageWidth) * 3 * kTileSize);
+    for (int row = 0; row < rows; ++row) {
+        if (progress && !progress(row, rows)) {
+            file.cancelWriting();
+            return fail(error, "Export canceled.");
+        }
+        const int bandHeight = qMin(kTileSize, imageHeight - row * kTileSize);
+
+        parallelFor(columns, [&](int begin, int end) {
+            QImage tile(kTileSize, kTileSize, QImage::Format_RGB32);
+            for (int column = begin; column < end; ++column) {
+                GV_TRACE_SCOPE("ImageExport::tile");
+                tile.fill(Qt::white);
+                {
+                    QPainter painter(&tile);
+                    painter.setRenderHint(QPainter::Antialiasing);
+                    painter.setFont(snapshot.font);
+                    painter.translate(-column * kTileSize, -row * kTileSize);
+                    painter.scale(scale, scale);
+                    painter.translate(-snapshot.bounds.topLeft());
+
+                    const QRectF area = painter.transform().inverted().mapRect(QRectF(column * kTileSize, row * kTileSize,
+                                                                                      kTileSize, kTileSize));
+                    auto paintItem = [&](int item) {
+                        if (item < edgeCount) {
+                            paintEdge(painter, snapshot.edges[item], lod);
+                        } else {
+                            paintNode(painter, snapshot.nodes[item - edgeCount], lod);
+                        }
+                    };
+                    for (int item : index.wideItems()) {
+                        if (item < edgeCount && edgeBounds(snapshot.edges[item]).intersects(area)) paintItem(item);
+                    }
+                    for (int slot = index.cellBegin(column, row); slot < index.cellEnd(column, row); ++slot) {
+                        paintItem(index.item(slot));
+                    }
+                    for (int item : index.wideItems()) {
+                        if (item >= edgeCount && nodeBounds(snapshot.nodes[item - edgeCount]).intersects(area)) paintItem(item);
+                    }
+                }
+
+                const int x0 = column * kTileSize;
+                const int tileWidth = qMin(kTileSize, imageWidth - x0);
+                for (int y = 0; y < bandHeight; ++y) {
+                    const QRgb* source = reinterpret_cast<const QRgb*>(tile.constScanLine(y));
+                    uchar* target = band.data() + (size_t(y) * imageWidth + x0) * 3;
+                    for (int x = 0; x < tileWidth; ++x) {
+                        target[3 * x] = uchar(qRed(source[x]));
+                        target[3 * x + 1] = uchar(qGreen(source[x]));
+                        target[3 * x + 2] = uchar(qBlue(source[x]));
+                    }
+                }
+            }
+        }, 1);
+
+        for (int y = 0; y < bandHeight; ++y) {
+            if (!png.writeRow(band.data() + size_t(y) * imageWidth * 3)) {
+                file.cancelWriting();
+                return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+            }
+        }
+    }
+
+    if (!png.end() || !file.commit()) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+    if (progress) progress(rows, rows);
+    return true;
+}
+
+bool writeSvg(const GraphScene &scene, const QString &fileName, QString *error)
+{
+    GV_TRACE_SCOPE("ImageExport::writeSvg");
+    // Only the bounds are collected up front; each item is then copied,
+    // painted and dropped in turn
+    QRectF bounds;
+    for (EdgeItem* edge : scene.edges()) bounds |= edgeBounds(edgeOf(edge));
+    for (NodeItem* node : scene.nodes()) bounds |= nodeBounds(nodeOf(node));
+    if (bounds.isEmpty()) return fail(error, "The graph is empty.");
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+
+    QSvgGenerator generator;
+    generator.setOutputDevice(&file);
+    generator.setSize(bounds.size().toSize());
+    generator.setViewBox(bounds);
+    generator.setTitle(QFileInfo(fileName).completeBaseName());
+
+    // Vector output is not rasterized at any particular scale, so
+    // everything is drawn at full detail
+    QPainter painter;
+    if (!painter.begin(&generator)) return fail(error, "Cannot write " + fileName);
+    painter.setFont(scene.font());
+    for (EdgeItem* edge : scene.edges()) paintEdge(painter, edgeOf(edge), 1.0);
+    for (NodeItem* node : scene.nodes()) paintNode(painter, nodeOf(node), 1.0);
+    painter.end();
+
+    if (file.error() != QFileDevice::NoError) return fail(error, "Cannot write " + fileName + ": " + file.errorString());
+    return true;
+}
+}
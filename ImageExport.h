@@ -0,0 +1,60 @@
+#ifndef IMAGEEXPORT_H
+#define IMAGEEXPORT_H
+
+#include <QColor>
+#include <QFont>
+#include <QLineF>
+#include <QPen>
+#include <QPolygonF>
+#include <QRectF>
+#include <QString>
+
+#include <functional>
+#include <vector>
+
+class GraphScene;
+
+// Flat copy of what the scene draws, taken on the GUI thread so the
+// export can paint from worker threads without touching any item.
+struct ImageSnapshot {
+    struct Node {
+        QRectF rect;
+        QColor color;
+        QPen pen;
+        QPointF labelPos;   // top-left of the label text block
+        QString label;
+    };
+    struct Edge {
+        QLineF line;
+        QPolygonF arrowHead;
+        QPen pen;
+        QPointF labelPos;
+        QString text;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    QRectF bounds;
+    QFont font;
+};
+
+namespace ImageExport {
+
+ImageSnapshot snapshot(const GraphScene& scene);
+
+// Renders at `scale` pixels per scene unit. The image is cut into bands
+// of square tiles; the tiles of one band are painted in parallel, with
+// the scene's level-of-detail rules for that scale, and the band is then
+// deflated into the PNG row by row. Memory stays at one band however
+// large the image. progress(done, total) counts bands; returning false
+// cancels the export.
+bool writePng(const ImageSnapshot& snapshot, const QString& fileName, double scale, QString* error = nullptr,
+              std::function<bool(int done, int total)> progress = nullptr);
+
+// Paints every item straight from the scene into a QSvgGenerator, one
+// element at a time, without a snapshot. GUI thread only.
+bool writeSvg(const GraphScene& scene, const QString& fileName, QString* error = nullptr);
+
+}
+
+#endif // IMAGEEXPORT_H
@@ -0,0 +1,121 @@
+#ifndef INDEXEDHEAP_H
+#define INDEXEDHEAP_H
+
+#include <vector>
+
+// Min-heap of integer items in [0, capacity) keyed by double, with a
+// position index so decreaseKey() is O(log n) instead of a re-insert.
+// Arity 4 keeps the sift-down comparisons within one or two cache lines.
+template <int Arity = 4>
+class IndexedHeap {
+public:
+    void resize(int capacity) {
+        position.assign(capacity, -1);
+        heap.clear();
+        keys.clear();
+    }
+
+    int capacity() const { return int(position.size()); }
+    bool empty() const { return heap.empty(); }
+    int size() const { return int(heap.size()); }
+    bool contains(int item) const { return position[item] >= 0; }
+
+    int top() const { return heap.front(); }
+    double topKey() const { return keys.front(); }
+
+    void push(int item, double key) {
+        int i = int(heap.size());
+        heap.push_back(item);
+        keys.push_back(key);
+        position[item] = i;
+        siftUp(i);
+    }
+
+    void decreaseKey(int item, double key) {
+        int i = position[item];
+        keys[i] = key;
+        siftUp(i);
+    }
+
+    // Inserts the item, or lowers its key if it is already queued.
+    void pushOrDecrease(int item, double key) {
+        if (contains(item)) {
+            if (key < keys[position[item]]) decreaseKey(item, key);
+        } else {
+            push(item, key);
+        }
+    }
+
+    int pop() {
+        int item = heap.front();
+        position[item] = -1;
+        int lastItem = heap.back();
+        double lastKey = keys.back();
+        heap.pop_back();
+        keys.pop_back();
+        if (!heap.empty()) {
+            heap[0] = lastItem;
+            keys[0] = lastKey;
+            position[lastItem] = 0;
+            siftDown(0);
+        }
+        return item;
+    }
+
+    // Empties the heap in O(size) without touching the whole index.
+    void clear() {
+        for (int item : heap) position[item] = -1;
+        heap.clear();
+        keys.clear();
+    }
+
+private:
+    void siftUp(int i) {
+        int item = heap[i];
+        double key = keys[i];
+        while (i > 0) {
+            int parent = (i - 1) / Arity;
+            if (!(key < keys[parent])) break;
+            move(parent, i);
+            i = parent;
+        }
+        place(item, key, i);
+    }
+
+    void siftDown(int i) {
+        int item = heap[i];
+        double key = keys[i];
+        const int n = int(heap.size());
+        while (true) {
+            int first = i * Arity + 1;
+            if (first >= n) break;
+            int last = first + Arity < n ? first + Arity : n;
+            int best = first;
+            for (int c = first + 1; c < last; ++c) {
+                if (keys[c] < keys[best]) best = c;
+            }
+            if (!(keys[best] < key)) break;
+            move(best, i);
+            i = best;
+        }
+        place(item, key, i);
+    }
+
+    void move(int from, int to) {
+        heap[to] = heap[from];
+        keys[to] = keys[from];
+        position[heap[to]] = to;
+    }
+
+    void place(int item, double key, int i) {
+        heap[i] = item;
+        keys[i] = key;
+        position[item] = i;
+    }
+
+    std::vector<int> heap;
+    std::vector<double> keys;
+    std::vector<int> position;
+};
+
+#endif // INDEXEDHEAP_H
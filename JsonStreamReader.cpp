@@ -0,0 +1,215 @@
+#include "JsonStreamReader.h"
+
+namespace {
+const int kBufferSize = 64 * 1024;
+
+void appendUtf8(QByteArray& out, uint code)
+{
+    if (code < 0x80) {
+        out.append(char(code));
+    } else if (code < 0x800) {
+        out.append(char(0xC0 | (code >> 6)));
+        out.append(char(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.append(char(0xE0 | (code >> 12)));
+        out.append(char(0x80 | ((code >> 6) & 0x3F)));
+        out.append(char(0x80 | (code & 0x3F)));
+    } else {
+        out.append(char(0xF0 | (code >> 18)));
+        out.append(char(0x80 | ((code >> 12) & 0x3F)));
+        out.append(char(0x80 | ((code >> 6) & 0x3F)));
+        out.append(char(0x80 | (code & 0x3F)));
+    }
+}
+
+int hexValue(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+}
+
+JsonStreamReader::JsonStreamReader(QIODevice *device) : device(device), buffer(kBufferSize, Qt::Uninitialized) {
+
+}
+
+bool JsonStreamReader::fill()
+{
+    consumed += length;
+    cursor = 0;
+    length = 0;
+    qint64 n = device->read(buffer.data(), buffer.size());
+    if (n <= 0) return false;
+    length = int(n);
+    return true;
+}
+
+int JsonStreamReader::peekByte()
+{
+    if (cursor == length && !fill()) return -1;
+    return uchar(buffer[cursor]);
+}
+
+int JsonStreamReader::getByte()
+{
+    if (cursor == length && !fill()) return -1;
+    return uchar(buffer[cursor++]);
+}
+
+bool JsonStreamReader::skipWhitespace()
+{
+    while (true) {
+        int c = peekByte();
+        if (c < 0) return false;
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',') {
+            ++cursor;
+            continue;
+        }
+        return true;
+    }
+}
+
+JsonStreamReader::Token JsonStreamReader::fail(const QString &message)
+{
+    if (error.isEmpty()) {
+        error = QString("%1 at byte %2").arg(message).arg(consumed + cursor);
+    }
+    return Invalid;
+}
+
+JsonStreamReader::Token JsonStreamReader::next()
+{
+    if (hasError()) return Invalid;
+    if (!skipWhitespace()) return EndOfDocument;
+
+    int c = getByte();
+    switch (c) {
+    case '{': return BeginObject;
+    case '}': return EndObject;
+    case '[': return BeginArray;
+    case ']': return EndArray;
+    case '"': {
+        if (!readString()) return fail("Unterminated string");
+        if (!skipWhitespace()) return String;
+        if (peekByte() == ':') {
+            ++cursor;
+            return Name;
+        }
+        return String;
+    }
+    case 't':
+        boolValue = true;
+        return readLiteral("rue") ? Bool : fail("Invalid literal");
+    case 'f':
+        boolValue = false;
+        return readLiteral("alse") ? Bool : fail("Invalid literal");
+    case 'n':
+        return readLiteral("ull") ? Null : fail("Invalid literal");
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            return readNumber(char(c)) ? Number : fail("Invalid number");
+        }
+        return fail("Unexpected character");
+    }
+}
+
+bool JsonStreamReader::readString()
+{
+    text.clear();
+    while (true) {
+        // Copy runs of plain bytes in one go
+        int start = cursor;
+        while (cursor < length && buffer[cursor] != '"' && buffer[cursor] != '\\') ++cursor;
+        text.append(buffer.constData() + start, cursor - start);
+
+        int c = getByte();
+        if (c < 0) return false;
+        if (c == '"') return true;
+        if (c != '\\') {
+            // The run stopped at a buffer boundary
+            text.append(char(c));
+            continue;
+        }
+
+        int e = getByte();
+        switch (e) {
+        case '"': text.append('"'); break;
+        case '\\': text.append('\\'); break;
+        case '/': text.append('/'); break;
+        case 'b': text.append('\b'); break;
+        case 'f': text.append('\f'); break;
+        case 'n': text.append('\n'); break;
+        case 'r': text.append('\r'); break;
+        case 't': text.append('\t'); break;
+        case 'u': {
+            auto readHex4 = [this]() -> int {
+                int v = 0;
+                for (int i = 0; i < 4; ++i) {
+                    int h = hexValue(getByte());
+                    if (h < 0) return -1;
+                    v = v * 16 + h;
+                }
+                return v;
+            };
+            int code = readHex4();
+            if (code < 0) return false;
+            if (code >= 0xD800 && code < 0xDC00 && peekByte() == '\\') {
+                getByte();
+                if (getByte() != 'u') return false;
+                int low = readHex4();
+                if (low < 0) return false;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            appendUtf8(text, uint(code));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+}
+
+bool JsonStreamReader::readNumber(char first)
+{
+    char digits[64];
+    int n = 0;
+    digits[n++] = first;
+    while (true) {
+        int c = peekByte();
+        bool numeric = (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+        if (!numeric) break;
+        if (n == int(sizeof(digits))) return false;
+        digits[n++] = char(c);
+        ++cursor;
+    }
+    bool ok = false;
+    numberValue = QByteArray::fromRawData(digits, n).toDouble(&ok);
+    return ok;
+}
+
+bool JsonStreamReader::readLiteral(const char *rest)
+{
+    for (; *rest; ++rest) {
+        if (getByte() != *rest) return false;
+    }
+    return true;
+}
+
+void JsonStreamReader::skipValue()
+{
+    Token t = next();
+    if (t == BeginObject || t == BeginArray) skipContainer();
+}
+
+void JsonStreamReader::skipContainer()
+{
+    int depth = 1;
+    while (depth > 0) {
+        Token t = next();
+        if (t == BeginObject || t == BeginArray) ++depth;
+        else if (t == EndObject || t == EndArray) --depth;
+        else if (t == Invalid || t == EndOfDocument) return;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef JSONSTREAMREADER_H
+#define JSONSTREAMREADER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+// Pull parser for JSON read straight from a QIODevice.
+//
+// Only a fixed-size window of the input is buffered, so memory stays flat
+// regardless of file size, and no document tree is built: the caller asks
+// for the next token and copies out what it needs. Separators are handled
+// internally; a string followed by ':' is reported as a Name.
+class JsonStreamReader {
+public:
+    enum Token {
+        Invalid,
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        Name,
+        String,
+        Number,
+        Bool,
+        Null,
+        EndOfDocument
+    };
+
+    explicit JsonStreamReader(QIODevice* device);
+
+    Token next();
+
+    // Value of the last Name/String, Number or Bool token.
+    QString string() const { return QString::fromUtf8(text); }
+    const QByteArray& utf8() const { return text; }
+    double number() const { return numberValue; }
+    bool boolean() const { return boolValue; }
+
+    // Skips the value that follows the last Name (or the remainder of the
+    // container whose Begin token was just read).
+    void skipValue();
+    void skipContainer();
+
+    bool hasError() const { return !error.isEmpty(); }
+    QString errorString() const { return error; }
+
+private:
+    bool fill();
+    int peekByte();
+    int getByte();
+    bool skipWhitespace();
+    bool readString();
+    bool readNumber(char first);
+    bool readLiteral(const char* rest);
+    Token fail(const QString& message);
+
+    QIODevice* device;
+    QByteArray buffer;
+    int cursor = 0;
+    int length = 0;
+    qint64 consumed = 0;
+
+    QByteArray text;
+    double numberValue = 0;
+    bool boolValue = false;
+    QString error;
+};
+
+#endif // JSONSTREAMREADER_H
@@ -0,0 +1,79 @@
+#include "LabelIndex.h"
+
+#include <algorithm>
+
+void LabelIndex::insert(const QString &label, int node)
+{
+    exact.insert(label, node);
+    sortedDirty = true;
+}
+
+void LabelIndex::remove(const QString &label, int node)
+{
+    exact.remove(label, node);
+    sortedDirty = true;
+}
+
+void LabelIndex::renumber(const QString &label, int from, int to)
+{
+    exact.remove(label, from);
+    exact.insert(label, to);
+    sortedDirty = true;
+}
+
+void LabelIndex::clear()
+{
+    exact.clear();
+    sorted.clear();
+    sortedDirty = false;
+}
+
+int LabelIndex::find(const QString &label) const
+{
+    return exact.value(label, -1);
+}
+
+void LabelIndex::ensureSorted() const
+{
+    if (!sortedDirty) return;
+
+    sorted.clear();
+    sorted.reserve(exact.size());
+    for (auto it = exact.cbegin(); it != exact.cend(); ++it) {
+        sorted.push_back({it.key().toCaseFolded(), it.value()});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key;
+    });
+    sortedDirty = false;
+}
+
+QVector<int> LabelIndex::search(const QString &text, int limit) const
+{
+    QVector<int> matches;
+    if (text.isEmpty()) return matches;
+
+    ensureSorted();
+    const QString needle = text.toCaseFolded();
+
+    // Prefix matches form one contiguous run in the sorted order.
+    auto first = std::lower_bound(sorted.cbegin(), sorted.cend(), needle, [](const Entry& e, const QString& key) {
+        return e.key < key;
+    });
+    auto it = first;
+    for (; it != sorted.cend() && it->key.startsWith(needle) && matches.size() < limit; ++it) {
+        matches.append(it->node);
+    }
+    auto prefixEnd = it;
+    while (prefixEnd != sorted.cend() && prefixEnd->key.startsWith(needle)) ++prefixEnd;
+
+    // Then the remaining labels that contain the text further in.
+    auto scan = [&](std::vector<Entry>::const_iterator from, std::vector<Entry>::const_iterator to) {
+        for (; from != to && matches.size() < limit; ++from) {
+            if (from->key.contains(needle)) matches.append(from->node);
+        }
+    };
+    scan(sorted.cbegin(), first);
+    scan(prefixEnd, sorted.cend());
+    return matches;
+}
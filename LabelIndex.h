@@ -0,0 +1,45 @@
+#ifndef LABELINDEX_H
+#define LABELINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+// Label -> node id index kept in step with the scene registry.
+//
+// Exact lookups go through a hash. Prefix and substring searches run over
+// a case-folded copy of the labels sorted once per batch of edits, so a
+// search never touches the QGraphicsTextItems.
+class LabelIndex {
+public:
+    void insert(const QString& label, int node);
+    void remove(const QString& label, int node);
+    void renumber(const QString& label, int from, int to);
+    void clear();
+
+    int size() const { return exact.size(); }
+
+    // Node with exactly this label, or -1. With duplicate labels the most
+    // recently inserted node wins.
+    int find(const QString& label) const;
+
+    // Nodes whose label starts with / contains `text`, case-insensitive,
+    // ordered by label. Prefix matches are listed before other substring
+    // matches.
+    QVector<int> search(const QString& text, int limit = 50) const;
+
+private:
+    struct Entry {
+        QString key;
+        int node;
+    };
+    void ensureSorted() const;
+
+    QMultiHash<QString, int> exact;
+    mutable std::vector<Entry> sorted;
+    mutable bool sortedDirty = false;
+};
+
+#endif // LABELINDEX_H
@@ -0,0 +1,81 @@
+#include "LayoutRunner.h"
+
+#include <QtConcurrent/QtConcurrent>
+#include <QElapsedTimer>
+
+LayoutRunner::LayoutRunner(QObject *parent) : QObject(parent) {
+
+}
+
+LayoutRunner::~LayoutRunner()
+{
+    stop();
+    // Workers publish frames through this object, so they must not
+    // outlive it. A stopped layout ends after its current iteration.
+    const auto pending = findChildren<QFutureWatcher<Frame>*>();
+    for (auto pendingWatcher : pending) {
+        pendingWatcher->waitForFinished();
+    }
+}
+
+void LayoutRunner::start(QSharedPointer<const GraphModel> graph, const ForceLayout::Settings &settings)
+{
+    stop();
+
+    const quint64 current = ++serial;
+    stopFlag = QSharedPointer<std::atomic<bool>>::create(false);
+    auto pending = QSharedPointer<std::atomic<bool>>::create(false);
+    framePending = pending;
+
+    auto publish = [this, current, pending](Frame frame) {
+        // Skip the frame if the GUI has not consumed the previous one yet
+        if (pending->exchange(true)) return;
+        QMetaObject::invokeMethod(this, [this, current, pending, frame]() {
+            pending->store(false);
+            if (current == serial && watcher) emit positionsUpdated(frame.xs, frame.ys, frame.iteration);
+        }, Qt::QueuedConnection);
+    };
+
+    auto finishedWatcher = new QFutureWatcher<Frame>(this);
+    watcher = finishedWatcher;
+    connect(finishedWatcher, &QFutureWatcher<Frame>::finished, this, [this, current, finishedWatcher]() {
+        finishedWatcher->deleteLater();
+        if (current != serial) return;
+
+        watcher = nullptr;
+        Frame frame = finishedWatcher->result();
+        emit positionsUpdated(frame.xs, frame.ys, frame.iteration);
+        emit finished();
+    });
+    finishedWatcher->setFuture(QtConcurrent::run(&LayoutRunner::execute, graph, settings, stopFlag, interval, publish));
+}
+
+void LayoutRunner::stop()
+{
+    if (!watcher) return;
+
+    // Positions already applied are kept; the worker exits after its
+    // current iteration and the watcher deletes itself.
+    stopFlag->store(true);
+    ++serial;
+    watcher = nullptr;
+    emit finished();
+}
+
+LayoutRunner::Frame LayoutRunner::execute(QSharedPointer<const GraphModel> graph, ForceLayout::Settings settings,
+                                          QSharedPointer<std::atomic<bool>> stopFlag, int interval,
+                                          std::function<void(Frame)> publish)
+{
+    ForceLayout layout(*graph, settings);
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!layout.done() && !stopFlag->load()) {
+        layout.step();
+        if (timer.elapsed() >= interval) {
+            publish(Frame{layout.xs(), layout.ys(), layout.iterationCount()});
+            timer.restart();
+        }
+    }
+    return Frame{layout.xs(), layout.ys(), layout.iterationCount()};
+}
@@ -0,0 +1,53 @@
+#ifndef LAYOUTRUNNER_H
+#define LAYOUTRUNNER_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "ForceLayout.h"
+
+// Runs a ForceLayout on the global thread pool against an immutable
+// GraphModel snapshot. Intermediate positions are posted back at most
+// every `interval` ms, and only once the previous batch has been applied,
+// so a slow scene update never queues up stale frames. All signals are
+// emitted on the thread that owns the runner (the GUI thread).
+class LayoutRunner : public QObject {
+    Q_OBJECT
+public:
+    explicit LayoutRunner(QObject* parent = nullptr);
+    ~LayoutRunner();
+
+    void start(QSharedPointer<const GraphModel> graph,
+               const ForceLayout::Settings& settings = ForceLayout::Settings());
+    void stop();
+    bool isRunning() const { return watcher != nullptr; }
+
+    int interval = 100;
+
+signals:
+    void positionsUpdated(const std::vector<double>& xs, const std::vector<double>& ys, int iteration);
+    void finished();
+
+private:
+    struct Frame {
+        std::vector<double> xs;
+        std::vector<double> ys;
+        int iteration = 0;
+    };
+
+    static Frame execute(QSharedPointer<const GraphModel> graph, ForceLayout::Settings settings,
+                         QSharedPointer<std::atomic<bool>> stopFlag, int interval,
+                         std::function<void(Frame)> publish);
+
+    QFutureWatcher<Frame>* watcher = nullptr;
+    QSharedPointer<std::atomic<bool>> stopFlag;
+    QSharedPointer<std::atomic<bool>> framePending;
+    quint64 serial = 0;
+};
+
+#endif // LAYOUTRUNNER_H
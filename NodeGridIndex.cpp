@@ -0,0 +1,101 @@
+#include "NodeGridIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NodeGridIndex::NodeGridIndex(double cellSize) : cell(cellSize > 0 ? cellSize : 1)
+{
+}
+
+void NodeGridIndex::clear(double cellSize)
+{
+    cell = cellSize > 0 ? cellSize : 1;
+    maxRadius = 0;
+    centers.clear();
+    cells.clear();
+}
+
+void NodeGridIndex::reserve(int nodeCount)
+{
+    centers.reserve(nodeCount);
+    cells.reserve(nodeCount);
+}
+
+std::uint64_t NodeGridIndex::cellKey(std::int32_t cx, std::int32_t cy) const
+{
+    return (std::uint64_t(std::uint32_t(cx)) << 32) | std::uint32_t(cy);
+}
+
+std::uint64_t NodeGridIndex::cellKey(double x, double y) const
+{
+    return cellKey(std::int32_t(std::floor(x / cell)), std::int32_t(std::floor(y / cell)));
+}
+
+void NodeGridIndex::insert(int node, double x, double y, double radius)
+{
+    centers.push_back({x, y, radius});
+    maxRadius = std::max(maxRadius, radius);
+    cells[cellKey(x, y)].push_back(node);
+}
+
+void NodeGridIndex::unlink(int node)
+{
+    auto it = cells.find(cellKey(centers[node].x, centers[node].y));
+    std::vector<int>& bucket = it->second;
+    *std::find(bucket.begin(), bucket.end(), node) = bucket.back();
+    bucket.pop_back();
+    if (bucket.empty()) cells.erase(it);
+}
+
+void NodeGridIndex::move(int node, double x, double y)
+{
+    Center& center = centers[node];
+    if (cellKey(center.x, center.y) != cellKey(x, y)) {
+        unlink(node);
+        cells[cellKey(x, y)].push_back(node);
+    }
+    center.x = x;
+    center.y = y;
+}
+
+void NodeGridIndex::remove(int node)
+{
+    unlink(node);
+    const int last = size() - 1;
+    if (node != last) {
+        std::vector<int>& bucket = cells[cellKey(centers[last].x, centers[last].y)];
+        *std::find(bucket.begin(), bucket.end(), last) = node;
+        centers[node] = centers[last];
+    }
+    centers.pop_back();
+    // maxRadius only ever grows until the next clear(); a stale value just
+    // widens the search a little
+}
+
+int NodeGridIndex::nodeAt(double x, double y) const
+{
+    const std::int32_t reach = std::int32_t(std::ceil(maxRadius / cell));
+    const std::int32_t cx = std::int32_t(std::floor(x / cell));
+    const std::int32_t cy = std::int32_t(std::floor(y / cell));
+
+    int best = -1;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    for (std::int32_t ix = cx - reach; ix <= cx + reach; ++ix) {
+        for (std::int32_t iy = cy - reach; iy <= cy + reach; ++iy) {
+            auto it = cells.find(cellKey(ix, iy));
+            if (it == cells.end()) continue;
+            for (int node : it->second) {
+                const Center& center = centers[node];
+                const double dx = x - center.x;
+                const double dy = y - center.y;
+                const double distance = dx * dx + dy * dy;
+                if (distance <= center.radius * center.radius && distance < bestDistance) {
+                    best = node;
+                    bestDistance = distance;
+                }
+            }
+        }
+    }
+    return best;
+}
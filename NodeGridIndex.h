@@ -0,0 +1,52 @@
+#ifndef NODEGRIDINDEX_H
+#define NODEGRIDINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over node centers, kept in step with the scene registry
+// (dense ids, swap-and-pop removal) so the mouse handlers can find the
+// node under the cursor without going through the BSP tree.
+//
+// The cell size follows the node size, so a point query looks at the
+// 3x3 cells around the cursor and a handful of nodes in each. Nodes
+// larger than a cell widen that neighbourhood instead of being lost.
+class NodeGridIndex {
+public:
+    explicit NodeGridIndex(double cellSize = 30);
+
+    // Drops every node and starts over with a new cell size
+    void clear(double cellSize);
+    void reserve(int nodeCount);
+
+    // `node` must be size(), as for GraphScene::addNode
+    void insert(int node, double x, double y, double radius);
+    void move(int node, double x, double y);
+    // Removes `node`; the last node takes over its id
+    void remove(int node);
+
+    int size() const { return int(centers.size()); }
+
+    // Node whose disc contains (x, y), or -1. Overlapping nodes resolve
+    // to the one with the nearest center.
+    int nodeAt(double x, double y) const;
+
+private:
+    struct Center {
+        double x;
+        double y;
+        double radius;
+    };
+
+    std::uint64_t cellKey(double x, double y) const;
+    std::uint64_t cellKey(std::int32_t cx, std::int32_t cy) const;
+    void unlink(int node);
+
+    double cell;
+    double maxRadius = 0;
+    std::vector<Center> centers;
+    std::unordered_map<std::uint64_t, std::vector<int>> cells;
+};
+
+#endif // NODEGRIDINDEX_H
@@ -0,0 +1,57 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QtConcurrent/QtConcurrent>
+#include <QVector>
+
+#include <algorithm>
+
+// Runs fn(begin, end) over contiguous chunks of [0, count) on the global
+// thread pool and waits for all of them. Small ranges run inline.
+template <typename Fn>
+void parallelFor(int count, Fn fn, int grain = 4096)
+{
+    if (count <= grain) {
+        if (count > 0) fn(0, count);
+        return;
+    }
+
+    QVector<int> starts;
+    starts.reserve(count / grain + 1);
+    for (int begin = 0; begin < count; begin += grain) {
+        starts.append(begin);
+    }
+    QtConcurrent::blockingMap(starts, [&](int begin) {
+        fn(begin, qMin(begin + grain, count));
+    });
+}
+
+// Sorts [first, last) by sorting chunks on the thread pool and merging
+// neighbouring runs in parallel rounds. Small ranges use std::sort.
+template <typename It, typename Less>
+void parallelSort(It first, It last, Less less, int grain = 32768)
+{
+    const int count = int(last - first);
+    if (count <= grain) {
+        std::sort(first, last, less);
+        return;
+    }
+
+    parallelFor(count, [&](int begin, int end) {
+        std::sort(first + begin, first + end, less);
+    }, grain);
+
+    for (int run = grain; run < count; run *= 2) {
+        const int pairs = (count + 2 * run - 1) / (2 * run);
+        parallelFor(pairs, [&](int begin, int end) {
+            for (int p = begin; p < end; ++p) {
+                const int lo = p * 2 * run;
+                const int mid = qMin(lo + run, count);
+                const int hi = qMin(lo + 2 * run, count);
+                std::inplace_merge(first + lo, first + mid, first + hi, less);
+            }
+        }, 1);
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,157 @@
+#include "PathQuery.h"
+#include "Trace.h"
+
+#include <QtConcurrent/QtConcurrent>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+PathQueryRunner::PathQueryRunner(QObject *parent) : QObject(parent) {
+
+}
+
+PathQueryRunner::~PathQueryRunner()
+{
+    cancel();
+    // Workers report progress through this object, so they must not
+    // outlive it. Canceled searches stop at their next checkpoint.
+    const auto pending = findChildren<QFutureWatcher<PathOutcome>*>();
+    for (auto pendingWatcher : pending) {
+        pendingWatcher->waitForFinished();
+    }
+}
+
+void PathQueryRunner::start(QSharedPointer<const GraphModel> graph, const PathQuery &query)
+{
+    cancel();
+
+    const quint64 current = ++serial;
+    cancelFlag = QSharedPointer<std::atomic<bool>>::create(false);
+
+    // Progress is forwarded through the event loop; reports from a query
+    // that has since been replaced are discarded.
+    auto report = [this, current](int settled) {
+        QMetaObject::invokeMethod(this, [this, current, settled]() {
+            if (current == serial && watcher) emit progress(settled);
+        }, Qt::QueuedConnection);
+    };
+
+    QSharedPointer<const LandmarkHeuristic> cachedLandmarks;
+    if (landmarks && landmarkTopology == query.topology) cachedLandmarks = landmarks;
+    QSharedPointer<const EuclideanHeuristic> cachedEuclidean;
+    if (euclideanModel == graph) cachedEuclidean = euclidean;
+
+    auto finishedWatcher = new QFutureWatcher<PathOutcome>(this);
+    watcher = finishedWatcher;
+    connect(finishedWatcher, &QFutureWatcher<PathOutcome>::finished, this, [this, current, finishedWatcher]() {
+        finishedWatcher->deleteLater();
+        if (current != serial) return;
+
+        watcher = nullptr;
+        PathOutcome outcome = finishedWatcher->result();
+        if (outcome.result.canceled) {
+            emit canceled();
+            return;
+        }
+        if (outcome.landmarks) {
+            landmarks = outcome.landmarks;
+            landmarkTopology = outcome.query.topology;
+        }
+        if (outcome.euclidean) {
+            euclidean = outcome.euclidean;
+            euclideanModel = outcome.graph;
+        }
+        emit finished(outcome);
+    });
+    finishedWatcher->setFuture(QtConcurrent::run(&PathQueryRunner::execute, graph, query, cachedLandmarks, cachedEuclidean,
+                                                     cancelFlag, report));
+}
+
+void PathQueryRunner::cancel()
+{
+    if (!watcher) return;
+
+    // The worker notices the flag at its next checkpoint; the watcher
+    // deletes itself once the future completes.
+    cancelFlag->store(true);
+    ++serial;
+    watcher = nullptr;
+    emit canceled();
+}
+
+PathOutcome PathQueryRunner::execute(QSharedPointer<const GraphModel> graph, PathQuery query,
+                                     QSharedPointer<const LandmarkHeuristic> landmarks,
+                                     QSharedPointer<const EuclideanHeuristic> euclidean,
+                                     QSharedPointer<std::atomic<bool>> cancelFlag,
+                                     std::function<void(int)> report)
+{
+    GV_TRACE_SCOPE("PathQueryRunner::execute");
+    QElapsedTimer timer;
+    timer.start();
+
+    PathOutcome outcome;
+    outcome.query = query;
+    outcome.graph = graph;
+
+    SearchControl control;
+    control.cancel = cancelFlag.data();
+    control.progress = report;
+    QSharedPointer<AlgorithmTrace> trace;
+    if (query.recordTrace && query.algorithm != Hierarchy_Algorithm) {
+        trace = QSharedPointer<AlgorithmTrace>::create(graph->nodeCount(), graph->edgeCount());
+        control.trace = trace.data();
+    }
+
+    ShortestPathEngine engine;
+    // Cached trees are repaired with Dijkstra, so they need non-negative weights
+    const bool useTrees = query.algorithm == Dijkstra_Algorithm && !graph->hasNegativeWeight();
+
+    if (useTrees && query.tree) {
+        // Settling the pending edits is the only search a cached tree needs
+        const int settled = query.tree->repair(*graph);
+        outcome.result = query.tree->path(*graph, query.target);
+        outcome.result.settled = settled;
+        outcome.tree = query.tree;
+    } else if (useTrees && query.buildTree) {
+        auto tree = QSharedPointer<ShortestPathTree>::create();
+        tree->source = query.source;
+        if (engine.fullTree(*graph, query.source, tree->dist, tree->predEdge, control)) {
+            // A full tree settles every reachable node
+            outcome.result = tree->path(*graph, query.target);
+            outcome.result.settled = int(std::count_if(tree->dist.begin(), tree->dist.end(),
+                                                       [](double d) { return d < std::numeric_limits<double>::infinity(); }));
+            outcome.tree = tree;
+        } else {
+            outcome.result.canceled = true;
+        }
+    } else if (query.algorithm == Dijkstra_Algorithm) {
+        outcome.result = engine.dijkstra(*graph, query.source, query.target, control);
+    } else if (query.algorithm == Hierarchy_Algorithm) {
+        outcome.result = engine.hierarchy(*query.hierarchy, query.source, query.target, control);
+    } else if (query.algorithm == Bidirectional_Algorithm) {
+        outcome.result = engine.bidirectional(*graph, query.source, query.target, control);
+    } else if (query.heuristic == Landmark_Heuristic) {
+        if (!landmarks) {
+            landmarks = QSharedPointer<const LandmarkHeuristic>::create(*graph);
+            outcome.landmarks = landmarks;
+        }
+        outcome.result = engine.aStar(*graph, query.source, query.target, *landmarks, control);
+    } else if (query.heuristic == Euclidean_Heuristic) {
+        // The scale takes a pass over every edge, so it is kept per snapshot
+        if (!euclidean) {
+            euclidean = QSharedPointer<const EuclideanHeuristic>::create(*graph);
+            outcome.euclidean = euclidean;
+        }
+        outcome.result = engine.aStar(*graph, query.source, query.target, *euclidean, control);
+    } else {
+        outcome.result = engine.aStar(*graph, query.source, query.target, ZeroHeuristic(), control);
+    }
+
+    outcome.elapsedMs = timer.elapsed();
+    if (trace && !outcome.result.canceled) {
+        trace->finish();
+        outcome.trace = trace;
+    }
+    GV_TRACE_COUNTER("nodes expanded", outcome.result.settled);
+    return outcome;
+}
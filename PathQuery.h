@@ -0,0 +1,94 @@
+#ifndef PATHQUERY_H
+#define PATHQUERY_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+
+#include <atomic>
+
+#include "GraphModel.h"
+#include "ShortestPath.h"
+#include "Heuristics.h"
+#include "PathTreeCache.h"
+#include "ContractionHierarchy.h"
+#include "AlgorithmTrace.h"
+
+enum PathAlgorithm{
+    Dijkstra_Algorithm,
+    AStar_Algorithm,
+    Bidirectional_Algorithm,
+    Hierarchy_Algorithm
+};
+
+struct PathQuery {
+    PathAlgorithm algorithm = Dijkstra_Algorithm;
+    HeuristicMode heuristic = Euclidean_Heuristic;
+    int source = -1;
+    int target = -1;
+    // Dijkstra only: settle the whole graph and return the tree as well,
+    // so later queries from the same source can be answered from it
+    bool buildTree = false;
+    // Dijkstra only: cached tree for source, taken out of PathTreeCache.
+    // The worker repairs it and answers from it instead of searching.
+    QSharedPointer<ShortestPathTree> tree;
+    // GraphScene::topologyRevision() of the snapshot. Landmark tables only
+    // depend on topology and weights, so they are reused while it holds.
+    quint64 topology = 0;
+    // Required by Hierarchy_Algorithm; must match the graph snapshot
+    QSharedPointer<const ContractionHierarchy> hierarchy;
+    // Log every step for TracePlayer (not for Hierarchy_Algorithm)
+    bool recordTrace = false;
+};
+
+struct PathOutcome {
+    PathQuery query;
+    PathResult result;
+    qint64 elapsedMs = 0;
+    QSharedPointer<const GraphModel> graph;
+    QSharedPointer<const LandmarkHeuristic> landmarks;
+    QSharedPointer<const EuclideanHeuristic> euclidean;
+    QSharedPointer<ShortestPathTree> tree;     // built or repaired, for PathTreeCache
+    QSharedPointer<const AlgorithmTrace> trace;
+};
+
+// Runs path queries on the global thread pool against an immutable
+// GraphModel snapshot. Only one query is live at a time: starting a new
+// one cancels the previous search and drops its result. All signals are
+// emitted on the thread that owns the runner (the GUI thread).
+class PathQueryRunner : public QObject {
+    Q_OBJECT
+public:
+    explicit PathQueryRunner(QObject* parent = nullptr);
+    ~PathQueryRunner();
+
+    void start(QSharedPointer<const GraphModel> graph, const PathQuery& query);
+    void cancel();
+    bool isRunning() const { return watcher != nullptr; }
+
+signals:
+    void progress(int settled);
+    void finished(const PathOutcome& outcome);
+    void canceled();
+
+private:
+    static PathOutcome execute(QSharedPointer<const GraphModel> graph, PathQuery query,
+                               QSharedPointer<const LandmarkHeuristic> landmarks,
+                               QSharedPointer<const EuclideanHeuristic> euclidean,
+                               QSharedPointer<std::atomic<bool>> cancelFlag,
+                               std::function<void(int)> report);
+
+    QFutureWatcher<PathOutcome>* watcher = nullptr;
+    QSharedPointer<std::atomic<bool>> cancelFlag;
+    quint64 serial = 0;
+
+    // Landmark tables are reused while the topology revision holds, across
+    // node moves. The Euclidean scale depends on positions, so it is kept
+    // per snapshot and keeps that snapshot alive.
+    QSharedPointer<const LandmarkHeuristic> landmarks;
+    quint64 landmarkTopology = 0;
+    QSharedPointer<const EuclideanHeuristic> euclidean;
+    QSharedPointer<const GraphModel> euclideanModel;
+};
+
+#endif // PATHQUERY_H
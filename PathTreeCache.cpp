@@ -0,0 +1,252 @@
+#include "PathTreeCache.h"
+#include "IndexedHeap.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+// Detaches root from its parent; the subtree is dropped on the next repair
+void cut(ShortestPathTree& tree, int root)
+{
+    tree.predEdge[root] = -1;
+    tree.cutRoots.push_back(root);
+}
+
+void renumber(std::vector<int>& nodes, int node, int lastNode)
+{
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+    std::replace(nodes.begin(), nodes.end(), lastNode, node);
+}
+
+void remap(std::vector<int>& nodes, const std::vector<int>& newNodeId)
+{
+    for (int& node : nodes) node = newNodeId[node];
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), -1), nodes.end());
+}
+}
+
+PathResult ShortestPathTree::path(const GraphModel& graph, int target) const
+{
+    PathResult result;
+    if (dist[target] == kInfinity) return result;
+
+    result.distance = dist[target];
+    for (int node = target; predEdge[node] >= 0; node = graph.edge(predEdge[node]).source) {
+        result.edges.push_back(predEdge[node]);
+    }
+    std::reverse(result.edges.begin(), result.edges.end());
+    return result;
+}
+
+void PathTreeCache::insert(QSharedPointer<ShortestPathTree> tree)
+{
+    for (Entry& entry : trees) {
+        if (entry.tree->source == tree->source) {
+            entry = Entry{tree, ++clock};
+            return;
+        }
+    }
+    if (int(trees.size()) >= capacity) {
+        auto oldest = std::min_element(trees.begin(), trees.end(),
+                                       [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        trees.erase(oldest);
+    }
+    trees.push_back(Entry{tree, ++clock});
+}
+
+void PathTreeCache::clear()
+{
+    trees.clear();
+    missed.clear();
+}
+
+QSharedPointer<ShortestPathTree> PathTreeCache::take(int source)
+{
+    for (auto it = trees.begin(); it != trees.end(); ++it) {
+        if (it->tree->source != source) continue;
+        QSharedPointer<ShortestPathTree> tree = it->tree;
+        trees.erase(it);
+        return tree;
+    }
+    return QSharedPointer<ShortestPathTree>();
+}
+
+bool PathTreeCache::repeatedMiss(int source)
+{
+    auto it = std::find(missed.begin(), missed.end(), source);
+    if (it != missed.end()) {
+        missed.erase(it);
+        return true;
+    }
+    if (int(missed.size()) >= capacity) missed.erase(missed.begin());
+    missed.push_back(source);
+    return false;
+}
+
+void PathTreeCache::nodeAdded()
+{
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        tree.dist.push_back(kInfinity);
+        tree.predEdge.push_back(-1);
+    }
+}
+
+void PathTreeCache::nodeRemoved(int node, int lastNode)
+{
+    // The node's edges are gone already; only the ids shift
+    trees.erase(std::remove_if(trees.begin(), trees.end(), [node](const Entry& entry) {
+        return entry.tree->source == node;
+    }), trees.end());
+
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        tree.dist[node] = tree.dist[lastNode];
+        tree.predEdge[node] = tree.predEdge[lastNode];
+        tree.dist.pop_back();
+        tree.predEdge.pop_back();
+        if (tree.source == lastNode) tree.source = node;
+        renumber(tree.seeds, node, lastNode);
+        renumber(tree.cutRoots, node, lastNode);
+    }
+    renumber(missed, node, lastNode);
+}
+
+void PathTreeCache::edgeAdded(int source, int target, double weight)
+{
+    if (weight < 0) {
+        clear();
+        return;
+    }
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        if (tree.dist[source] + weight < tree.dist[target]) tree.seeds.push_back(target);
+    }
+}
+
+void PathTreeCache::edgeRemoved(int edgeId, int target, int lastEdgeId, int lastTarget)
+{
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        if (tree.predEdge[target] == edgeId) cut(tree, target);
+        // The scene moves its last edge into the freed id
+        if (lastEdgeId != edgeId && tree.predEdge[lastTarget] == lastEdgeId) tree.predEdge[lastTarget] = edgeId;
+    }
+}
+
+void PathTreeCache::compact(const std::vector<int>& newNodeId, const std::vector<int>& newEdgeId)
+{
+    trees.erase(std::remove_if(trees.begin(), trees.end(), [&](const Entry& entry) {
+        return newNodeId[entry.tree->source] < 0;
+    }), trees.end());
+
+    const int kept = int(newNodeId.size() - std::count(newNodeId.begin(), newNodeId.end(), -1));
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        remap(tree.seeds, newNodeId);
+        remap(tree.cutRoots, newNodeId);
+        tree.source = newNodeId[tree.source];
+        std::vector<double> dist(kept);
+        std::vector<int> predEdge(kept);
+        for (size_t node = 0; node < newNodeId.size(); ++node) {
+            const int to = newNodeId[node];
+            if (to < 0) continue;
+            dist[to] = tree.dist[node];
+            const int edge = tree.predEdge[node];
+            predEdge[to] = edge < 0 ? -1 : newEdgeId[edge];
+            // The tree edge went with the removed nodes
+            if (edge >= 0 && predEdge[to] < 0) tree.cutRoots.push_back(to);
+        }
+        tree.dist = std::move(dist);
+        tree.predEdge = std::move(predEdge);
+    }
+    remap(missed, newNodeId);
+}
+
+void PathTreeCache::edgeWeightChanged(int edgeId, int source, int target, double oldWeight, double newWeight)
+{
+    if (newWeight < 0) {
+        clear();
+        return;
+    }
+    for (Entry& entry : trees) {
+        ShortestPathTree& tree = *entry.tree;
+        if (newWeight < oldWeight) {
+            if (tree.dist[source] + newWeight < tree.dist[target]) tree.seeds.push_back(target);
+        } else if (newWeight > oldWeight && tree.predEdge[target] == edgeId) {
+            cut(tree, target);
+        }
+    }
+}
+
+int ShortestPathTree::repair(const GraphModel& graph)
+{
+    GV_TRACE_SCOPE("ShortestPathTree::repair");
+    const int n = graph.nodeCount();
+
+    if (!cutRoots.empty()) {
+        // Label every node inside (1) or outside (2) a cut subtree by
+        // walking up its predecessor chain until a labeled node is reached.
+        // One pass covers all cuts since the last repair.
+        std::vector<char> state(n, 0);
+        for (int root : cutRoots) state[root] = 1;
+        cutRoots.clear();
+        std::vector<int> chain;
+        for (int start = 0; start < n; ++start) {
+            int node = start;
+            while (!state[node] && predEdge[node] >= 0) {
+                chain.push_back(node);
+                node = graph.edge(predEdge[node]).source;
+            }
+            const char label = state[node] ? state[node] : 2;
+            state[node] = label;
+            for (int visited : chain) state[visited] = label;
+            chain.clear();
+        }
+
+        for (int node = 0; node < n; ++node) {
+            if (state[node] != 1) continue;
+            if (dist[node] != kInfinity) seeds.push_back(node);
+            dist[node] = kInfinity;
+            predEdge[node] = -1;
+        }
+    }
+    if (seeds.empty()) return 0;
+
+    IndexedHeap<4> queue;
+    queue.resize(n);
+
+    // Best entry into each seed from the current labels
+    for (int node : seeds) {
+        for (int slot = graph.inBegin(node); slot < graph.inEnd(node); ++slot) {
+            const double alt = dist[graph.inSource(slot)] + graph.inWeight(slot);
+            if (alt < dist[node]) {
+                dist[node] = alt;
+                predEdge[node] = graph.inEdgeId(slot);
+            }
+        }
+        if (dist[node] < kInfinity) queue.pushOrDecrease(node, dist[node]);
+    }
+    seeds.clear();
+
+    // Dijkstra over improvements only; everything else keeps its label
+    int settled = 0;
+    while (!queue.empty()) {
+        const int current = queue.pop();
+        const double base = dist[current];
+        ++settled;
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            const int neighbor = graph.target(slot);
+            const double alt = base + graph.weight(slot);
+            if (alt < dist[neighbor]) {
+                dist[neighbor] = alt;
+                predEdge[neighbor] = graph.edgeId(slot);
+                queue.pushOrDecrease(neighbor, alt);
+            }
+        }
+    }
+    return settled;
+}
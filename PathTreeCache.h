@@ -0,0 +1,79 @@
+#ifndef PATHTREECACHE_H
+#define PATHTREECACHE_H
+
+#include <QSharedPointer>
+
+#include <vector>
+
+#include "GraphModel.h"
+#include "ShortestPath.h"
+
+// Full shortest-path tree from one source: distances and the edge each
+// node is reached by, indexed by node id.
+struct ShortestPathTree {
+    int source = -1;
+    std::vector<double> dist;
+    std::vector<int> predEdge;
+
+    // Nodes whose distance may have to drop since the last repair: heads
+    // of new or cheaper edges.
+    std::vector<int> seeds;
+    // Nodes whose tree edge was removed or became more expensive. Their
+    // subtrees are invalidated together on the next repair.
+    std::vector<int> cutRoots;
+
+    bool needsRepair() const { return !seeds.empty() || !cutRoots.empty(); }
+    // Brings the tree up to date with graph, which must match the edits
+    // reported since the last repair. Returns the number of nodes settled.
+    int repair(const GraphModel& graph);
+
+    // Walks the tree back from target; O(path length).
+    PathResult path(const GraphModel& graph, int target) const;
+};
+
+// Bounded LRU cache of shortest-path trees keyed by source.
+//
+// GraphScene reports every edit as it happens, in O(1) per cached tree.
+// Edits that can only make paths shorter record a seed; removing or
+// raising the weight of a tree edge cuts the tree below that edge. The
+// cuts and seeds are settled by ShortestPathTree::repair(): one pass
+// drops every cut subtree, then a Dijkstra starting from the seeds fixes
+// the labels on the current GraphModel, so untouched parts of the tree
+// are kept. PathQueryRunner repairs trees on its worker thread; a tree
+// is taken out of the cache for that and put back with the result.
+// Trees assume non-negative weights; a negative weight empties the cache.
+class PathTreeCache {
+public:
+    explicit PathTreeCache(int capacity = 8) : capacity(capacity) {}
+
+    void clear();
+    void insert(QSharedPointer<ShortestPathTree> tree);
+    // Removes and returns the tree for source, or null. Does not repair it.
+    QSharedPointer<ShortestPathTree> take(int source);
+    // Records a query from source that had no tree. True if source was
+    // asked for before, i.e. a full tree is worth building this time.
+    bool repeatedMiss(int source);
+
+    // Edit notifications, in the scene's id space at the time of the call
+    void nodeAdded();
+    void nodeRemoved(int node, int lastNode);
+    void edgeAdded(int source, int target, double weight);
+    void edgeRemoved(int edgeId, int target, int lastEdgeId, int lastTarget);
+    void edgeWeightChanged(int edgeId, int source, int target, double oldWeight, double newWeight);
+    // Bulk removal: every surviving id moves to newNodeId / newEdgeId, -1
+    // for the removed ones. O(n + m) per cached tree.
+    void compact(const std::vector<int>& newNodeId, const std::vector<int>& newEdgeId);
+
+private:
+    struct Entry {
+        QSharedPointer<ShortestPathTree> tree;
+        quint64 lastUse;
+    };
+
+    int capacity;
+    quint64 clock = 0;
+    std::vector<Entry> trees;
+    std::vector<int> missed;    // recent sources without a tree, oldest first
+};
+
+#endif // PATHTREECACHE_H
@@ -0,0 +1,447 @@
+#include "ShortestPath.h"
+#include "Heuristics.h"
+#include "ContractionHierarchy.h"
+#include "AlgorithmTrace.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+namespace {
+const double kInfinity = std::numeric_limits<double>::infinity();
+}
+
+void ShortestPathEngine::prepare(int nodeCount)
+{
+    if (int(dist.size()) != nodeCount) {
+        dist.assign(nodeCount, kInfinity);
+        predEdge.assign(nodeCount, -1);
+        closed.assign(nodeCount, 0);
+        queue.resize(nodeCount);
+    } else {
+        for (int node : touched) {
+            dist[node] = kInfinity;
+            predEdge[node] = -1;
+            closed[node] = 0;
+        }
+        queue.clear();
+    }
+    touched.clear();
+}
+
+void ShortestPathEngine::prepareBackward(int nodeCount)
+{
+    if (int(distBackward.size()) != nodeCount) {
+        distBackward.assign(nodeCount, kInfinity);
+        succEdge.assign(nodeCount, -1);
+        closedBackward.assign(nodeCount, 0);
+        queueBackward.resize(nodeCount);
+    } else {
+        for (int node : touchedBackward) {
+            distBackward[node] = kInfinity;
+            succEdge[node] = -1;
+            closedBackward[node] = 0;
+        }
+        queueBackward.clear();
+    }
+    touchedBackward.clear();
+}
+
+void ShortestPathEngine::label(int node, double distance, int edgeId)
+{
+    if (dist[node] == kInfinity) touched.push_back(node);
+    dist[node] = distance;
+    predEdge[node] = edgeId;
+}
+
+void ShortestPathEngine::labelBackward(int node, double distance, int edgeId)
+{
+    if (distBackward[node] == kInfinity) touchedBackward.push_back(node);
+    distBackward[node] = distance;
+    succEdge[node] = edgeId;
+}
+
+PathResult ShortestPathEngine::buildPath(const GraphModel& graph, int target, int settled) const
+{
+    PathResult result;
+    result.settled = settled;
+    if (dist[target] == kInfinity) return result;
+
+    result.distance = dist[target];
+    for (int node = target; predEdge[node] >= 0; node = graph.edge(predEdge[node]).source) {
+        result.edges.push_back(predEdge[node]);
+    }
+    std::reverse(result.edges.begin(), result.edges.end());
+    return result;
+}
+
+bool ShortestPathEngine::checkpoint(const SearchControl& control, int settled)
+{
+    if (settled % control.interval != 0) return true;
+    if (control.cancel && control.cancel->load(std::memory_order_relaxed)) return false;
+    if (control.progress) control.progress(settled);
+    return true;
+}
+
+PathResult ShortestPathEngine::dijkstra(const GraphModel& graph, int source, int target,
+                                        const SearchControl& control)
+{
+    GV_TRACE_SCOPE("ShortestPath::dijkstra");
+    prepare(graph.nodeCount());
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+
+    int settled = 0;
+    while (!queue.empty()) {
+        int current = queue.pop();
+        closed[current] = 1;
+        ++settled;
+        if (control.trace) control.trace->settle(current);
+        if (current == target) break;
+        if (!checkpoint(control, settled)) {
+            PathResult canceled;
+            canceled.settled = settled;
+            canceled.canceled = true;
+            return canceled;
+        }
+
+        const double base = dist[current];
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            int neighbor = graph.target(slot);
+            if (closed[neighbor]) continue;
+
+            double alt = base + graph.weight(slot);
+            if (control.trace) control.trace->relax(graph.edgeId(slot), neighbor, alt < dist[neighbor]);
+            if (alt < dist[neighbor]) {
+                label(neighbor, alt, graph.edgeId(slot));
+                queue.pushOrDecrease(neighbor, alt);
+            }
+        }
+    }
+
+    return buildPath(graph, target, settled);
+}
+
+PathResult ShortestPathEngine::aStar(const GraphModel& graph, int source, int target, const Heuristic& heuristic,
+                                     const SearchControl& control)
+{
+    GV_TRACE_SCOPE("ShortestPath::aStar");
+    prepare(graph.nodeCount());
+
+    // The heuristics are consistent, so a node is final once expanded and
+    // the queue key g + h never has to be revised for closed nodes.
+    label(source, 0, -1);
+    queue.push(source, heuristic.estimate(source, target));
+
+    int expanded = 0;
+    while (!queue.empty()) {
+        int current = queue.pop();
+        closed[current] = 1;
+        ++expanded;
+        if (control.trace) control.trace->settle(current);
+        if (current == target) break;
+        if (!checkpoint(control, expanded)) {
+            PathResult canceled;
+            canceled.settled = expanded;
+            canceled.canceled = true;
+            return canceled;
+        }
+
+        const double base = dist[current];
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            int neighbor = graph.target(slot);
+            if (closed[neighbor]) continue;
+
+            double tentative = base + graph.weight(slot);
+            if (control.trace) control.trace->relax(graph.edgeId(slot), neighbor, tentative < dist[neighbor]);
+            if (tentative < dist[neighbor]) {
+                label(neighbor, tentative, graph.edgeId(slot));
+                queue.pushOrDecrease(neighbor, tentative + heuristic.estimate(neighbor, target));
+            }
+        }
+    }
+
+    return buildPath(graph, target, expanded);
+}
+
+PathResult ShortestPathEngine::bidirectional(const GraphModel& graph, int source, int target,
+                                             const SearchControl& control)
+{
+    GV_TRACE_SCOPE("ShortestPath::bidirectional");
+    prepare(graph.nodeCount());
+    prepareBackward(graph.nodeCount());
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+    labelBackward(target, 0, -1);
+    queueBackward.push(target, 0);
+
+    // Best s-t distance through a node labeled from both sides so far
+    double best = source == target ? 0 : kInfinity;
+    int meet = source == target ? source : -1;
+
+    int settled = 0;
+    while (!queue.empty() && !queueBackward.empty()) {
+        if (queue.topKey() + queueBackward.topKey() >= best) break;
+        ++settled;
+        if (!checkpoint(control, settled)) {
+            PathResult canceled;
+            canceled.settled = settled;
+            canceled.canceled = true;
+            return canceled;
+        }
+
+        if (queue.size() <= queueBackward.size()) {
+            int current = queue.pop();
+            closed[current] = 1;
+            if (control.trace) control.trace->settle(current);
+            const double base = dist[current];
+            for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+                int neighbor = graph.target(slot);
+                if (closed[neighbor]) continue;
+
+                double alt = base + graph.weight(slot);
+                if (control.trace) control.trace->relax(graph.edgeId(slot), neighbor, alt < dist[neighbor]);
+                if (alt < dist[neighbor]) {
+                    label(neighbor, alt, graph.edgeId(slot));
+                    queue.pushOrDecrease(neighbor, alt);
+                    if (alt + distBackward[neighbor] < best) {
+                        best = alt + distBackward[neighbor];
+                        meet = neighbor;
+                    }
+                }
+            }
+        } else {
+            int current = queueBackward.pop();
+            closedBackward[current] = 1;
+            if (control.trace) control.trace->settle(current);
+            const double base = distBackward[current];
+            for (int slot = graph.inBegin(current); slot < graph.inEnd(current); ++slot) {
+                int neighbor = graph.inSource(slot);
+                if (closedBackward[neighbor]) continue;
+
+                double alt = base + graph.inWeight(slot);
+                if (control.trace) control.trace->relax(graph.inEdgeId(slot), neighbor, alt < distBackward[neighbor]);
+                if (alt < distBackward[neighbor]) {
+                    labelBackward(neighbor, alt, graph.inEdgeId(slot));
+                    queueBackward.pushOrDecrease(neighbor, alt);
+                    if (alt + dist[neighbor] < best) {
+                        best = alt + dist[neighbor];
+                        meet = neighbor;
+                    }
+                }
+            }
+        }
+    }
+
+    PathResult result;
+    result.settled = settled;
+    if (meet < 0) return result;
+
+    result.distance = best;
+    for (int node = meet; predEdge[node] >= 0; node = graph.edge(predEdge[node]).source) {
+        result.edges.push_back(predEdge[node]);
+    }
+    std::reverse(result.edges.begin(), result.edges.end());
+    for (int node = meet; succEdge[node] >= 0; node = graph.edge(succEdge[node]).target) {
+        result.edges.push_back(succEdge[node]);
+    }
+    return result;
+}
+
+PathResult ShortestPathEngine::hierarchy(const ContractionHierarchy& ch, int source, int target,
+                                         const SearchControl& control)
+{
+    GV_TRACE_SCOPE("ShortestPath::hierarchy");
+    prepare(ch.nodeCount());
+    prepareBackward(ch.nodeCount());
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+    labelBackward(target, 0, -1);
+    queueBackward.push(target, 0);
+
+    double best = source == target ? 0 : kInfinity;
+    int meet = source == target ? source : -1;
+
+    // Unlike plain bidirectional search the two sides cannot stop on the
+    // sum of their minima: the meeting node is the highest-ranked node
+    // of the path, so each side runs until it alone reaches best.
+    int settled = 0;
+    while (true) {
+        const bool forwardOpen = !queue.empty() && queue.topKey() < best;
+        const bool backwardOpen = !queueBackward.empty() && queueBackward.topKey() < best;
+        if (!forwardOpen && !backwardOpen) break;
+        ++settled;
+        if (!checkpoint(control, settled)) {
+            PathResult canceled;
+            canceled.settled = settled;
+            canceled.canceled = true;
+            return canceled;
+        }
+
+        const bool forward = forwardOpen && (!backwardOpen || queue.topKey() <= queueBackward.topKey());
+        if (forward) {
+            int current = queue.pop();
+            closed[current] = 1;
+            const double base = dist[current];
+            for (int slot = ch.upBegin(current); slot < ch.upEnd(current); ++slot) {
+                int neighbor = ch.upTarget(slot);
+                double alt = base + ch.upWeight(slot);
+                if (alt < dist[neighbor]) {
+                    label(neighbor, alt, ch.upArc(slot));
+                    queue.pushOrDecrease(neighbor, alt);
+                    if (alt + distBackward[neighbor] < best) {
+                        best = alt + distBackward[neighbor];
+                        meet = neighbor;
+                    }
+                }
+            }
+        } else {
+            int current = queueBackward.pop();
+            closedBackward[current] = 1;
+            const double base = distBackward[current];
+            for (int slot = ch.downBegin(current); slot < ch.downEnd(current); ++slot) {
+                int neighbor = ch.downSource(slot);
+                double alt = base + ch.downWeight(slot);
+                if (alt < distBackward[neighbor]) {
+                    labelBackward(neighbor, alt, ch.downArc(slot));
+                    queueBackward.pushOrDecrease(neighbor, alt);
+                    if (alt + dist[neighbor] < best) {
+                        best = alt + dist[neighbor];
+                        meet = neighbor;
+                    }
+                }
+            }
+        }
+    }
+
+    PathResult result;
+    result.settled = settled;
+    if (meet < 0) return result;
+
+    result.distance = best;
+    std::vector<int> arcs;
+    for (int node = meet; predEdge[node] >= 0; node = ch.arc(predEdge[node]).source) {
+        arcs.push_back(predEdge[node]);
+    }
+    std::reverse(arcs.begin(), arcs.end());
+    for (int node = meet; succEdge[node] >= 0; node = ch.arc(succEdge[node]).target) {
+        arcs.push_back(succEdge[node]);
+    }
+    for (int arc : arcs) ch.unpack(arc, result.edges);
+    return result;
+}
+
+void ShortestPathEngine::oneToMany(const GraphModel& graph, int source, const std::vector<int>& targets,
+                                   double* distances, const std::vector<double>* potential)
+{
+    GV_TRACE_SCOPE("ShortestPath::oneToMany");
+    const int n = graph.nodeCount();
+    prepare(n);
+    if (int(wanted.size()) != n) wanted.assign(n, 0);
+
+    int remaining = 0;
+    for (int target : targets) {
+        if (!wanted[target]) {
+            wanted[target] = 1;
+            ++remaining;
+        }
+    }
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+    while (!queue.empty() && remaining > 0) {
+        int current = queue.pop();
+        closed[current] = 1;
+        if (wanted[current]) {
+            wanted[current] = 0;
+            --remaining;
+        }
+
+        const double base = dist[current];
+        const double offset = potential ? (*potential)[current] : 0;
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            int neighbor = graph.target(slot);
+            if (closed[neighbor]) continue;
+
+            double weight = graph.weight(slot);
+            if (potential) weight += offset - (*potential)[neighbor];
+            double alt = base + weight;
+            if (alt < dist[neighbor]) {
+                label(neighbor, alt, graph.edgeId(slot));
+                queue.pushOrDecrease(neighbor, alt);
+            }
+        }
+    }
+    for (int target : targets) wanted[target] = 0;
+
+    for (size_t j = 0; j < targets.size(); ++j) {
+        const int target = targets[j];
+        double d = closed[target] ? dist[target] : kInfinity;
+        if (potential && d < kInfinity) d += (*potential)[target] - (*potential)[source];
+        distances[j] = d;
+    }
+}
+
+void ShortestPathEngine::oneToAll(const GraphModel& graph, int source, std::vector<double>& distances)
+{
+    GV_TRACE_SCOPE("ShortestPath::oneToAll");
+    prepare(graph.nodeCount());
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+    while (!queue.empty()) {
+        int current = queue.pop();
+        closed[current] = 1;
+
+        const double base = dist[current];
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            int neighbor = graph.target(slot);
+            if (closed[neighbor]) continue;
+
+            double alt = base + graph.weight(slot);
+            if (alt < dist[neighbor]) {
+                label(neighbor, alt, graph.edgeId(slot));
+                queue.pushOrDecrease(neighbor, alt);
+            }
+        }
+    }
+
+    distances = dist;
+}
+
+bool ShortestPathEngine::fullTree(const GraphModel& graph, int source, std::vector<double>& distances,
+                                  std::vector<int>& predecessors, const SearchControl& control)
+{
+    GV_TRACE_SCOPE("ShortestPath::fullTree");
+    prepare(graph.nodeCount());
+
+    label(source, 0, -1);
+    queue.push(source, 0);
+    int settled = 0;
+    while (!queue.empty()) {
+        int current = queue.pop();
+        closed[current] = 1;
+        ++settled;
+        if (control.trace) control.trace->settle(current);
+        if (!checkpoint(control, settled)) return false;
+
+        const double base = dist[current];
+        for (int slot = graph.outBegin(current); slot < graph.outEnd(current); ++slot) {
+            int neighbor = graph.target(slot);
+            if (closed[neighbor]) continue;
+
+            double alt = base + graph.weight(slot);
+            if (control.trace) control.trace->relax(graph.edgeId(slot), neighbor, alt < dist[neighbor]);
+            if (alt < dist[neighbor]) {
+                label(neighbor, alt, graph.edgeId(slot));
+                queue.pushOrDecrease(neighbor, alt);
+            }
+        }
+    }
+
+    distances = dist;
+    predecessors = predEdge;
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef SHORTESTPATH_H
+#define SHORTESTPATH_H
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "GraphModel.h"
+#include "IndexedHeap.h"
+
+class Heuristic;
+class ContractionHierarchy;
+class AlgorithmTrace;
+
+struct PathResult {
+    std::vector<int> edges;     // edge ids in order from source to target
+    double distance = std::numeric_limits<double>::infinity();
+    int settled = 0;            // nodes popped from the queue
+    bool canceled = false;
+
+    bool found() const { return distance < std::numeric_limits<double>::infinity(); }
+};
+
+// Lets another thread stop a running search and watch its progress.
+// Both are polled every `interval` settled nodes, so a search that is
+// not observed pays one counter compare per pop. With a trace, every
+// settle and relaxation is also logged for replay (dijkstra, aStar,
+// bidirectional and fullTree).
+struct SearchControl {
+    const std::atomic<bool>* cancel = nullptr;
+    std::function<void(int settled)> progress;
+    int interval = 4096;
+    AlgorithmTrace* trace = nullptr;
+};
+
+// Point-to-point shortest path search over a GraphModel.
+//
+// Distances and predecessor edges live in flat vectors indexed by node id.
+// The engine keeps them between queries and only resets the entries the
+// previous query touched, so one engine should be reused for many queries.
+class ShortestPathEngine {
+public:
+    PathResult dijkstra(const GraphModel& graph, int source, int target,
+                        const SearchControl& control = SearchControl());
+    PathResult aStar(const GraphModel& graph, int source, int target, const Heuristic& heuristic,
+                     const SearchControl& control = SearchControl());
+
+    // Forward search from source over out-edges and backward search from
+    // target over in-edges, expanding whichever side has the smaller
+    // queue. Stops once the two queue minima together reach the best
+    // meeting distance, so the result is exact.
+    PathResult bidirectional(const GraphModel& graph, int source, int target,
+                             const SearchControl& control = SearchControl());
+
+    // Upward search from source and downward-reverse search from target
+    // in a contraction hierarchy. Each side stops once its queue minimum
+    // reaches the best meeting distance; shortcuts are unpacked, so the
+    // result holds original edge ids.
+    PathResult hierarchy(const ContractionHierarchy& ch, int source, int target,
+                         const SearchControl& control = SearchControl());
+
+    // Dijkstra from source until every target is settled; distances[j]
+    // receives the distance to targets[j] (infinity if unreachable). With
+    // a potential, edges are searched with the Johnson weights
+    // w + p[u] - p[v] and the results are mapped back to real distances.
+    void oneToMany(const GraphModel& graph, int source, const std::vector<int>& targets,
+                   double* distances, const std::vector<double>* potential = nullptr);
+
+    // Full single-source run; distances[v] is infinity when v is unreachable.
+    void oneToAll(const GraphModel& graph, int source, std::vector<double>& distances);
+
+    // Full single-source run that also returns the predecessor edge of
+    // every node (-1 for the source and unreachable nodes). Returns false
+    // if canceled; the outputs are then left untouched.
+    bool fullTree(const GraphModel& graph, int source, std::vector<double>& distances,
+                  std::vector<int>& predecessors, const SearchControl& control = SearchControl());
+
+private:
+    void prepare(int nodeCount);
+    void prepareBackward(int nodeCount);
+    void label(int node, double distance, int edgeId);
+    void labelBackward(int node, double distance, int edgeId);
+    PathResult buildPath(const GraphModel& graph, int target, int settled) const;
+    static bool checkpoint(const SearchControl& control, int settled);
+
+    std::vector<double> dist;
+    std::vector<int> predEdge;
+    std::vector<char> closed;
+    std::vector<int> touched;
+    IndexedHeap<4> queue;
+    std::vector<char> wanted;   // oneToMany() targets not settled yet
+
+    // Backward side of bidirectional() and hierarchy(); succEdge leads
+    // towards the target
+    std::vector<double> distBackward;
+    std::vector<int> succEdge;
+    std::vector<char> closedBackward;
+    std::vector<int> touchedBackward;
+    IndexedHeap<4> queueBackward;
+};
+
+#endif // SHORTESTPATH_H
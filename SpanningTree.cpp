@@ -0,0 +1,197 @@
+#include "SpanningTree.h"
+#include "IndexedHeap.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+namespace {
+// Undirected adjacency: for node u, the slots [offsets[u], offsets[u+1])
+// of `edges` hold the ids of all edges touching u.
+struct Incidence {
+    std::vector<int> offsets;
+    std::vector<int> edges;
+
+    explicit Incidence(const GraphModel& graph) {
+        const int n = graph.nodeCount();
+        offsets.assign(n + 1, 0);
+        for (int id = 0; id < graph.edgeCount(); ++id) {
+            offsets[graph.edge(id).source + 1]++;
+            offsets[graph.edge(id).target + 1]++;
+        }
+        for (int u = 0; u < n; ++u) offsets[u + 1] += offsets[u];
+        edges.resize(offsets[n]);
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (int id = 0; id < graph.edgeCount(); ++id) {
+            edges[cursor[graph.edge(id).source]++] = id;
+            edges[cursor[graph.edge(id).target]++] = id;
+        }
+    }
+};
+
+// Strict total order on edges: weight, then id
+bool lighter(const GraphModel& graph, int a, int b) {
+    const double wa = graph.edge(a).weight;
+    const double wb = graph.edge(b).weight;
+    return wa < wb || (wa == wb && a < b);
+}
+
+void finish(const GraphModel& graph, SpanningForest& forest) {
+    forest.totalWeight = 0;
+    for (int id : forest.edges) forest.totalWeight += graph.edge(id).weight;
+    forest.components = graph.nodeCount() - int(forest.edges.size());
+}
+}
+
+void UnionFind::reset(int count)
+{
+    parent.resize(count);
+    size.assign(count, 1);
+    for (int i = 0; i < count; ++i) parent[i] = i;
+}
+
+int UnionFind::find(int item)
+{
+    while (parent[item] != item) {
+        parent[item] = parent[parent[item]];
+        item = parent[item];
+    }
+    return item;
+}
+
+bool UnionFind::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b) return false;
+    if (size[a] < size[b]) std::swap(a, b);
+    parent[b] = a;
+    size[a] += size[b];
+    return true;
+}
+
+SpanningForest SpanningTree::kruskal(const GraphModel& graph)
+{
+    SpanningForest forest;
+    const int n = graph.nodeCount();
+
+    std::vector<int> order(graph.edgeCount());
+    for (int id = 0; id < graph.edgeCount(); ++id) order[id] = id;
+    parallelSort(order.begin(), order.end(), [&](int a, int b) { return lighter(graph, a, b); });
+
+    UnionFind sets(n);
+    for (int id : order) {
+        const GraphModel::Edge& e = graph.edge(id);
+        if (sets.unite(e.source, e.target)) {
+            forest.edges.push_back(id);
+            if (int(forest.edges.size()) == n - 1) break;
+        }
+    }
+    finish(graph, forest);
+    return forest;
+}
+
+SpanningForest SpanningTree::prim(const GraphModel& graph)
+{
+    SpanningForest forest;
+    const int n = graph.nodeCount();
+    const Incidence incidence(graph);
+
+    std::vector<int> via(n, -1);
+    std::vector<char> inTree(n, 0);
+    IndexedHeap<4> queue;
+    queue.resize(n);
+
+    // One tree per component: restart from every node not reached yet
+    for (int root = 0; root < n; ++root) {
+        if (inTree[root]) continue;
+        queue.push(root, 0);
+        while (!queue.empty()) {
+            const int u = queue.pop();
+            inTree[u] = 1;
+            if (via[u] >= 0) forest.edges.push_back(via[u]);
+
+            for (int k = incidence.offsets[u]; k < incidence.offsets[u + 1]; ++k) {
+                const int id = incidence.edges[k];
+                const GraphModel::Edge& e = graph.edge(id);
+                const int v = e.source == u ? e.target : e.source;
+                if (inTree[v]) continue;
+                if (via[v] < 0 || lighter(graph, id, via[v])) {
+                    via[v] = id;
+                    queue.pushOrDecrease(v, e.weight);
+                }
+            }
+        }
+    }
+    finish(graph, forest);
+    return forest;
+}
+
+SpanningForest SpanningTree::boruvka(const GraphModel& graph)
+{
+    SpanningForest forest;
+    const int n = graph.nodeCount();
+    const Incidence incidence(graph);
+
+    UnionFind sets(n);
+    std::vector<int> component(n);
+    for (int u = 0; u < n; ++u) component[u] = u;
+    std::vector<int> nodeBest(n);
+    std::vector<int> cheapest(n);
+
+    while (true) {
+        // Cheapest edge leaving the component of each node. Reads only
+        // `component`, so nodes are scanned independently.
+        parallelFor(n, [&](int begin, int end) {
+            for (int u = begin; u < end; ++u) {
+                int best = -1;
+                for (int k = incidence.offsets[u]; k < incidence.offsets[u + 1]; ++k) {
+                    const int id = incidence.edges[k];
+                    const GraphModel::Edge& e = graph.edge(id);
+                    if (component[e.source] == component[e.target]) continue;
+                    if (best < 0 || lighter(graph, id, best)) best = id;
+                }
+                nodeBest[u] = best;
+            }
+        });
+
+        // Reduce to one edge per component
+        std::fill(cheapest.begin(), cheapest.end(), -1);
+        for (int u = 0; u < n; ++u) {
+            const int id = nodeBest[u];
+            int& best = cheapest[component[u]];
+            if (id >= 0 && (best < 0 || lighter(graph, id, best))) best = id;
+        }
+
+        // With a strict edge order the chosen edges cannot form a cycle;
+        // unite() only skips an edge picked by both of its components.
+        bool merged = false;
+        for (int c = 0; c < n; ++c) {
+            const int id = cheapest[c];
+            if (id < 0) continue;
+            if (sets.unite(graph.edge(id).source, graph.edge(id).target)) {
+                forest.edges.push_back(id);
+                merged = true;
+            }
+        }
+        if (!merged) break;
+
+        for (int u = 0; u < n; ++u) component[u] = sets.find(u);
+    }
+    finish(graph, forest);
+    return forest;
+}
+
+SpanningForest SpanningTree::run(const GraphModel& graph, SpanningAlgorithm algorithm)
+{
+    GV_TRACE_SCOPE("SpanningTree::run");
+    switch (algorithm) {
+    case Prim_Algorithm:
+        return prim(graph);
+    case Boruvka_Algorithm:
+        return boruvka(graph);
+    case Kruskal_Algorithm:
+    default:
+        return kruskal(graph);
+    }
+}
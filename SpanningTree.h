@@ -0,0 +1,50 @@
+#ifndef SPANNINGTREE_H
+#define SPANNINGTREE_H
+
+#include <vector>
+
+#include "GraphModel.h"
+
+enum SpanningAlgorithm{
+    Kruskal_Algorithm,
+    Prim_Algorithm,
+    Boruvka_Algorithm
+};
+
+struct SpanningForest {
+    std::vector<int> edges;     // edge ids in the forest
+    double totalWeight = 0;
+    int components = 0;         // trees in the forest; 1 when the graph is connected
+};
+
+// Disjoint sets over 0..n-1 with union by size and path halving.
+class UnionFind {
+public:
+    explicit UnionFind(int count = 0) { reset(count); }
+
+    void reset(int count);
+    int find(int item);
+    // False if both items were already in the same set.
+    bool unite(int a, int b);
+
+private:
+    std::vector<int> parent;
+    std::vector<int> size;
+};
+
+// Minimum spanning forest of a GraphModel, treating every edge as
+// undirected. Kruskal and Boruvka break weight ties by edge id and return
+// the same forest; Prim may pick a different forest of equal weight.
+namespace SpanningTree {
+    // Parallel sort of the edges, then one union-find pass.
+    SpanningForest kruskal(const GraphModel& graph);
+    // Grows one tree per component from an IndexedHeap of frontier nodes.
+    SpanningForest prim(const GraphModel& graph);
+    // Rounds of "cheapest edge leaving each component"; the edge scan of
+    // each round runs on the thread pool.
+    SpanningForest boruvka(const GraphModel& graph);
+
+    SpanningForest run(const GraphModel& graph, SpanningAlgorithm algorithm);
+}
+
+#endif // SPANNINGTREE_H
@@ -0,0 +1,160 @@
+#include "Trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+struct Event {
+    const char* name;
+    char phase;         // 'X' complete, 'C' counter
+    int thread;
+    qint64 timestamp;
+    double value;       // duration in us for 'X', counter value for 'C'
+};
+
+std::atomic<bool> recording{false};
+QMutex mutex;
+std::vector<Event> events;
+std::unique_ptr<QFile> output;     // opened by start() so a bad path fails early
+
+QElapsedTimer& traceClock()
+{
+    static QElapsedTimer timer;
+    if (!timer.isValid()) timer.start();
+    return timer;
+}
+
+// Small stable ids read better in the trace viewer than native handles
+int threadId()
+{
+    static std::atomic<int> next{1};
+    thread_local int id = next++;
+    return id;
+}
+
+void append(const Event& event)
+{
+    QMutexLocker locker(&mutex);
+    if (recording.load(std::memory_order_relaxed)) events.push_back(event);
+}
+
+}
+
+bool Trace::start(const QString& fileName)
+{
+    QMutexLocker locker(&mutex);
+    if (recording.load()) return false;
+    std::unique_ptr<QFile> file(new QFile(fileName));
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    traceClock();
+    output = std::move(file);
+    events.clear();
+    events.reserve(1 << 16);
+    recording.store(true);
+    return true;
+}
+
+void Trace::stop()
+{
+    QMutexLocker locker(&mutex);
+    if (!recording.exchange(false)) return;
+    QFile& file = *output;
+
+    QByteArray buffer("{\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        if (i) buffer += ",\n";
+        buffer += "{\"name\":\"";
+        buffer += e.name;
+        buffer += "\",\"ph\":\"";
+        buffer += e.phase;
+        buffer += "\",\"pid\":1,\"tid\":" + QByteArray::number(e.thread)
+                + ",\"ts\":" + QByteArray::number(e.timestamp);
+        if (e.phase == 'X') {
+            buffer += ",\"dur\":" + QByteArray::number(qint64(e.value)) + "}";
+        } else {
+            buffer += ",\"args\":{\"value\":" + QByteArray::number(e.value, 'g', 12) + "}}";
+        }
+        if (buffer.size() > (1 << 20)) {
+            file.write(buffer);
+            buffer.clear();
+        }
+    }
+    buffer += "\n]}\n";
+    file.write(buffer);
+    output.reset();
+    events.clear();
+    events.shrink_to_fit();
+}
+
+bool Trace::isRecording()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+qint64 Trace::nowUs()
+{
+    return traceClock().nsecsElapsed() / 1000;
+}
+
+void Trace::complete(const char* name, qint64 beginUs, qint64 endUs)
+{
+    append(Event{name, 'X', threadId(), beginUs, double(endUs - beginUs)});
+}
+
+void Trace::counter(const char* name, double value)
+{
+    if (!isRecording()) return;
+    append(Event{name, 'C', threadId(), nowUs(), value});
+}
+
+qint64 Trace::peakMemoryBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return qint64(counters.PeakWorkingSetSize);
+    return 0;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(Q_OS_MACOS)
+    return qint64(usage.ru_maxrss);             // bytes
+#else
+    return qint64(usage.ru_maxrss) * 1024;      // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+qint64 Trace::heapBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks + info.hblkhd);
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return qint64(counters.WorkingSetSize);
+    return 0;
+#else
+    return 0;
+#endif
+}
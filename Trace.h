@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+// Scoped timing in Chrome trace-event format (load the file in
+// chrome://tracing or ui.perfetto.dev).
+//
+// The GV_TRACE_* macros expand to nothing unless the build defines
+// GV_TRACE (qmake CONFIG += trace). When compiled in, events are only
+// recorded between Trace::start() and Trace::stop(); outside that window
+// a scope costs one relaxed atomic load.
+namespace Trace {
+
+// Opens (truncates) the output file and starts recording; false if the
+// file cannot be written or a recording is already running.
+bool start(const QString& fileName);
+// Writes the recorded events and stops recording.
+void stop();
+bool isRecording();
+
+qint64 nowUs();
+void complete(const char* name, qint64 beginUs, qint64 endUs);
+void counter(const char* name, double value);
+
+class Scope {
+public:
+    explicit Scope(const char* name) : name(isRecording() ? name : nullptr), begin(this->name ? nowUs() : 0) {}
+    ~Scope() { if (name) complete(name, begin, nowUs()); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+private:
+    const char* name;
+    qint64 begin;
+};
+
+// Peak resident set size of the process in bytes, or 0 if unknown.
+qint64 peakMemoryBytes();
+// Bytes currently allocated on the heap where the C library reports it
+// (glibc), otherwise the current working set; 0 if unknown.
+qint64 heapBytes();
+
+}
+
+#define GV_TRACE_CONCAT_(a, b) a##b
+#define GV_TRACE_CONCAT(a, b) GV_TRACE_CONCAT_(a, b)
+
+#ifdef GV_TRACE
+#define GV_TRACE_SCOPE(name) Trace::Scope GV_TRACE_CONCAT(gvTraceScope, __LINE__)(name)
+#define GV_TRACE_COUNTER(name, value) Trace::counter(name, value)
+#else
+#define GV_TRACE_SCOPE(name) do {} while (0)
+#define GV_TRACE_COUNTER(name, value) do {} while (0)
+#endif
+
+#endif // TRACE_H
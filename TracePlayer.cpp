@@ -0,0 +1,117 @@
+#include "TracePlayer.h"
+
+TracePlayer::TracePlayer(QObject *parent) : QObject(parent)
+{
+    timer.setInterval(33);
+    connect(&timer, &QTimer::timeout, this, &TracePlayer::tick);
+}
+
+void TracePlayer::setTrace(QSharedPointer<const AlgorithmTrace> newTrace)
+{
+    clear();
+    trace = newTrace;
+    if (!trace) return;
+    nodeStates.assign(trace->nodeCount(), AlgorithmTrace::Node_Unseen);
+    edgeStates.assign(trace->edgeCount(), AlgorithmTrace::Edge_Untouched);
+    nodeDirty.assign(trace->nodeCount(), 0);
+    edgeDirty.assign(trace->edgeCount(), 0);
+    emit positionChanged(0);
+}
+
+void TracePlayer::clear()
+{
+    timer.stop();
+    trace.reset();
+    cursor = 0;
+    carry = 0;
+    nodeStates.clear();
+    edgeStates.clear();
+    nodeDirty.clear();
+    edgeDirty.clear();
+}
+
+void TracePlayer::play()
+{
+    if (!trace) return;
+    if (cursor >= trace->size()) seek(0);
+    carry = 0;
+    clock.start();
+    timer.start();
+}
+
+void TracePlayer::pause()
+{
+    timer.stop();
+}
+
+void TracePlayer::seek(int position)
+{
+    if (!trace) return;
+    position = qBound(0, position, trace->size());
+    if (position == cursor) return;
+
+    std::vector<quint8> previousNodes = nodeStates;
+    std::vector<quint8> previousEdges = edgeStates;
+    if (position > cursor && position - cursor <= trace->keyframeInterval()) {
+        // Short hops forward are cheaper to replay than to restore
+        for (; cursor < position; ++cursor) AlgorithmTrace::apply(trace->event(cursor), nodeStates, edgeStates);
+    } else {
+        trace->stateAt(position, nodeStates, edgeStates);
+        cursor = position;
+    }
+
+    for (int node = 0; node < int(nodeStates.size()); ++node) {
+        if (nodeStates[node] != previousNodes[node]) markNode(node);
+    }
+    for (int edge = 0; edge < int(edgeStates.size()); ++edge) {
+        if (edgeStates[edge] != previousEdges[edge]) markEdge(edge);
+    }
+    publish();
+    // Scrubbing to the end finishes the replay as playing through does
+    if (cursor >= trace->size()) emit finished();
+}
+
+void TracePlayer::tick()
+{
+    carry += speed * clock.restart() / 1000.0;
+    const int steps = int(qMin<double>(carry, trace->size() - cursor));
+    carry -= steps;
+
+    const int end = cursor + steps;
+    for (; cursor < end; ++cursor) {
+        const TraceEvent& event = trace->event(cursor);
+        AlgorithmTrace::apply(event, nodeStates, edgeStates);
+        markNode(event.node);
+        if (event.edge() >= 0) markEdge(event.edge());
+    }
+    if (steps > 0) publish();
+
+    if (cursor >= trace->size()) {
+        timer.stop();
+        emit finished();
+    }
+}
+
+void TracePlayer::markNode(int node)
+{
+    if (nodeDirty[node]) return;
+    nodeDirty[node] = 1;
+    dirtyNodes.push_back(node);
+}
+
+void TracePlayer::markEdge(int edge)
+{
+    if (edgeDirty[edge]) return;
+    edgeDirty[edge] = 1;
+    dirtyEdges.push_back(edge);
+}
+
+void TracePlayer::publish()
+{
+    for (int node : dirtyNodes) nodeDirty[node] = 0;
+    for (int edge : dirtyEdges) edgeDirty[edge] = 0;
+    emit changed(dirtyNodes, dirtyEdges);
+    dirtyNodes.clear();
+    dirtyEdges.clear();
+    emit positionChanged(cursor);
+}
@@ -0,0 +1,64 @@
+#ifndef TRACEPLAYER_H
+#define TRACEPLAYER_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <vector>
+
+#include "AlgorithmTrace.h"
+
+// Replays an AlgorithmTrace on a QTimer. Each tick advances by as many
+// events as the speed allows for the elapsed time and reports only the
+// nodes and edges whose state changed, so the scene is updated once per
+// frame however fast the replay runs. seek() restores any position from
+// the trace's keyframes without re-running the search.
+class TracePlayer : public QObject {
+    Q_OBJECT
+public:
+    explicit TracePlayer(QObject* parent = nullptr);
+
+    void setTrace(QSharedPointer<const AlgorithmTrace> trace);
+    void clear();
+    bool hasTrace() const { return !trace.isNull(); }
+
+    void play();
+    void pause();
+    bool isPlaying() const { return timer.isActive(); }
+    void setSpeed(double eventsPerSecond) { speed = eventsPerSecond; }
+    void seek(int position);
+
+    int position() const { return cursor; }
+    int length() const { return trace ? trace->size() : 0; }
+    quint8 nodeState(int node) const { return nodeStates[node]; }
+    quint8 edgeState(int edge) const { return edgeStates[edge]; }
+
+signals:
+    void changed(const std::vector<int>& nodes, const std::vector<int>& edges);
+    void positionChanged(int position);
+    void finished();    // the end was reached, by playing or by seek()
+
+private:
+    void tick();
+    void markNode(int node);
+    void markEdge(int edge);
+    void publish();
+
+    QSharedPointer<const AlgorithmTrace> trace;
+    QTimer timer;
+    QElapsedTimer clock;
+    double speed = 1000;
+    double carry = 0;           // fractional events owed from earlier ticks
+    int cursor = 0;
+
+    std::vector<quint8> nodeStates;
+    std::vector<quint8> edgeStates;
+    std::vector<char> nodeDirty;
+    std::vector<char> edgeDirty;
+    std::vector<int> dirtyNodes;
+    std::vector<int> dirtyEdges;
+};
+
+#endif // TRACEPLAYER_H
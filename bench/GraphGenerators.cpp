@@ -0,0 +1,199 @@
+#include "GraphGenerators.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+void addBoth(GraphData& data, int a, int b, double weight)
+{
+    data.edges.push_back({a, b, weight});
+    data.edges.push_back({b, a, weight});
+}
+
+double distance(const GraphData& data, int a, int b)
+{
+    return std::hypot(data.nodes[b].x - data.nodes[a].x, data.nodes[b].y - data.nodes[a].y);
+}
+
+void addNodes(GraphData& data, int nodeCount)
+{
+    data.nodes.resize(nodeCount);
+    for (int u = 0; u < nodeCount; ++u) {
+        data.nodes[u].label = QString::number(u);
+    }
+}
+
+}
+
+GraphData GraphGenerators::randomGeometric(int nodeCount, quint32 seed)
+{
+    GraphData data;
+    addNodes(data, nodeCount);
+    std::mt19937 random(seed);
+
+    const double side = kSpacing * std::sqrt(double(nodeCount));
+    std::uniform_real_distribution<double> coordinate(0, side);
+    for (GraphData::Node& node : data.nodes) {
+        node.x = coordinate(random);
+        node.y = coordinate(random);
+    }
+
+    // Bucket the points into cells of one radius so each point only
+    // compares against its own and the neighbouring cells.
+    const double radius = kSpacing * std::sqrt(6 / M_PI);
+    const int cells = std::max(1, int(side / radius));
+    const double cellSize = side / cells;
+    auto cellOf = [&](double v) { return std::min(cells - 1, int(v / cellSize)); };
+
+    std::vector<int> cellStart(size_t(cells) * cells + 1, 0);
+    for (const GraphData::Node& node : data.nodes) {
+        cellStart[size_t(cellOf(node.y)) * cells + cellOf(node.x) + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+    std::vector<int> cellNodes(nodeCount);
+    std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (int u = 0; u < nodeCount; ++u) {
+        cellNodes[cursor[size_t(cellOf(data.nodes[u].y)) * cells + cellOf(data.nodes[u].x)]++] = u;
+    }
+
+    data.edges.reserve(size_t(nodeCount) * 7);
+    for (int u = 0; u < nodeCount; ++u) {
+        const int cx = cellOf(data.nodes[u].x);
+        const int cy = cellOf(data.nodes[u].y);
+        for (int y = std::max(0, cy - 1); y <= std::min(cells - 1, cy + 1); ++y) {
+            for (int x = std::max(0, cx - 1); x <= std::min(cells - 1, cx + 1); ++x) {
+                const size_t cell = size_t(y) * cells + x;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    const int v = cellNodes[k];
+                    if (v <= u) continue;
+                    const double d = distance(data, u, v);
+                    if (d <= radius) addBoth(data, u, v, d);
+                }
+            }
+        }
+    }
+    return data;
+}
+
+GraphData GraphGenerators::grid(int nodeCount, quint32 seed)
+{
+    GraphData data;
+    addNodes(data, nodeCount);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> weight(kSpacing, 2 * kSpacing);
+
+    const int side = std::max(1, int(std::ceil(std::sqrt(double(nodeCount)))));
+    data.edges.reserve(size_t(nodeCount) * 4);
+    for (int u = 0; u < nodeCount; ++u) {
+        const int row = u / side;
+        const int column = u % side;
+        data.nodes[u].x = column * kSpacing;
+        data.nodes[u].y = row * kSpacing;
+        if (column + 1 < side && u + 1 < nodeCount) addBoth(data, u, u + 1, weight(random));
+        if (u + side < nodeCount) addBoth(data, u, u + side, weight(random));
+    }
+    return data;
+}
+
+GraphData GraphGenerators::scaleFree(int nodeCount, int attach, quint32 seed)
+{
+    GraphData data;
+    addNodes(data, nodeCount);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> weight(1, 10);
+
+    // Sunflower spiral; the layout carries no meaning for this family
+    const double golden = M_PI * (3 - std::sqrt(5.0));
+    for (int u = 0; u < nodeCount; ++u) {
+        const double r = kSpacing * std::sqrt(u + 0.5);
+        data.nodes[u].x = r * std::cos(u * golden);
+        data.nodes[u].y = r * std::sin(u * golden);
+    }
+
+    // Every endpoint is appended to `ends`, so a uniform pick from it is
+    // a pick proportional to degree.
+    std::vector<int> ends;
+    ends.reserve(size_t(nodeCount) * attach * 2);
+    data.edges.reserve(size_t(nodeCount) * attach * 2);
+    const int core = std::min(nodeCount, attach + 1);
+    for (int u = 1; u < core; ++u) {
+        addBoth(data, u - 1, u, weight(random));
+        ends.push_back(u - 1);
+        ends.push_back(u);
+    }
+    std::vector<int> chosen;
+    for (int u = core; u < nodeCount; ++u) {
+        chosen.clear();
+        while (int(chosen.size()) < attach) {
+            const int v = ends[std::uniform_int_distribution<size_t>(0, ends.size() - 1)(random)];
+            if (std::find(chosen.begin(), chosen.end(), v) == chosen.end()) chosen.push_back(v);
+        }
+        for (int v : chosen) {
+            addBoth(data, u, v, weight(random));
+            ends.push_back(u);
+            ends.push_back(v);
+        }
+    }
+    return data;
+}
+
+GraphData GraphGenerators::roadLike(int nodeCount, quint32 seed)
+{
+    GraphData data;
+    addNodes(data, nodeCount);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> jitter(-0.3 * kSpacing, 0.3 * kSpacing);
+    std::uniform_real_distribution<double> unit(0, 1);
+
+    const int side = std::max(1, int(std::ceil(std::sqrt(double(nodeCount)))));
+    for (int u = 0; u < nodeCount; ++u) {
+        data.nodes[u].x = (u % side) * kSpacing + jitter(random);
+        data.nodes[u].y = (u / side) * kSpacing + jitter(random);
+    }
+
+    // Streets: lattice edges, some missing, slowed down by a random factor
+    data.edges.reserve(size_t(nodeCount) * 4);
+    for (int u = 0; u < nodeCount; ++u) {
+        const int column = u % side;
+        if (column + 1 < side && u + 1 < nodeCount && unit(random) > 0.1) {
+            addBoth(data, u, u + 1, distance(data, u, u + 1) * (1 + 0.5 * unit(random)));
+        }
+        if (u + side < nodeCount && unit(random) > 0.1) {
+            addBoth(data, u, u + side, distance(data, u, u + side) * (1 + 0.5 * unit(random)));
+        }
+    }
+
+    // Highways: every `stride` rows and columns, joining junctions
+    // `stride` apart at below street cost
+    const int stride = 8;
+    for (int row = 0; row < side; row += stride) {
+        for (int column = 0; column < side; column += stride) {
+            const int u = row * side + column;
+            if (u >= nodeCount) continue;
+            const int right = u + stride;
+            const int down = u + stride * side;
+            if (column + stride < side && right < nodeCount) addBoth(data, u, right, distance(data, u, right) * 0.7);
+            if (down < nodeCount) addBoth(data, u, down, distance(data, u, down) * 0.7);
+        }
+    }
+    return data;
+}
+
+QStringList GraphGenerators::names()
+{
+    return {"geometric", "grid", "scalefree", "road"};
+}
+
+bool GraphGenerators::generate(const QString& name, int nodeCount, GraphData& data, quint32 seed)
+{
+    if (name == "geometric") data = randomGeometric(nodeCount, seed);
+    else if (name == "grid") data = grid(nodeCount, seed);
+    else if (name == "scalefree") data = scaleFree(nodeCount, 3, seed);
+    else if (name == "road") data = roadLike(nodeCount, seed);
+    else return false;
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef GRAPHGENERATORS_H
+#define GRAPHGENERATORS_H
+
+#include <QString>
+#include <QStringList>
+
+#include "GraphIO.h"
+
+// Synthetic graphs for benchmarking. All generators are deterministic for
+// a given seed, place nodes about `kSpacing` scene units apart and add
+// edges in both directions, so any node can usually reach any other.
+namespace GraphGenerators {
+
+const double kSpacing = 60;
+
+// Uniform points in a square, joined to every neighbour within a radius
+// chosen for an average out-degree of about six. Weights are distances.
+GraphData randomGeometric(int nodeCount, quint32 seed = 1);
+// Square 4-neighbour lattice with random weights in [spacing, 2 * spacing].
+GraphData grid(int nodeCount, quint32 seed = 1);
+// Barabasi-Albert preferential attachment, `attach` edges per new node;
+// produces a few very high degree hubs. Weights are random in [1, 10].
+GraphData scaleFree(int nodeCount, int attach = 3, quint32 seed = 1);
+// Jittered lattice with a tenth of the streets removed and a sparse
+// network of faster long-distance "highway" edges.
+GraphData roadLike(int nodeCount, quint32 seed = 1);
+
+QStringList names();
+// Generator by name as listed in names(); false for an unknown name.
+bool generate(const QString& name, int nodeCount, GraphData& data, quint32 seed = 1);
+
+}
+
+#endif // GRAPHGENERATORS_H
@@ -0,0 +1,18 @@
+# Headless benchmark runner:
+#   qmake bench/bench.pro && make && ./bench --sizes 1k,10k -o results.json
+
+QT       += core gui widgets concurrent
+
+CONFIG += c++17 console qt
+CONFIG -= app_bundle
+
+TARGET = bench
+
+include(../engine.pri)
+
+SOURCES += \
+    main.cpp \
+    GraphGenerators.cpp
+
+HEADERS += \
+    GraphGenerators.h
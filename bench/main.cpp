@@ -0,0 +1,302 @@
+// Headless benchmark: generates synthetic graphs and times the engine,
+// the file formats, scene population and offscreen rendering. Results
+// are written as JSON, one record per generator and size.
+
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "Graph.h"
+#include "GraphGenerators.h"
+#include "SpanningTree.h"
+
+namespace {
+
+struct Options {
+    QStringList generators;
+    QList<int> sizes;
+    int queries = 20;
+    int maxSceneNodes = 200000;
+    int maxHierarchyNodes = 200000;
+    bool render = true;
+};
+
+template <typename Fn>
+double timeMs(Fn fn)
+{
+    QElapsedTimer timer;
+    timer.start();
+    fn();
+    return timer.nsecsElapsed() / 1e6;
+}
+
+// Every algorithm must agree with Dijkstra on each pair; the first
+// disagreement per algorithm is reported in `error`
+bool benchPaths(const GraphModel& graph, const Options& options, QJsonObject& metrics, QString* error)
+{
+    const int n = graph.nodeCount();
+    if (n < 2) return true;
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    std::vector<std::pair<int, int>> pairs(options.queries);
+    for (auto& pair : pairs) pair = {pick(random), pick(random)};
+
+    ShortestPathEngine engine;
+    std::vector<double> expected;
+    QStringList mismatches;
+    auto run = [&](const QString& name, auto search) {
+        qint64 settled = 0;
+        std::vector<double> distances(pairs.size());
+        const double ms = timeMs([&]() {
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                const PathResult result = search(pairs[i].first, pairs[i].second);
+                settled += result.settled;
+                distances[i] = result.distance;
+            }
+        });
+        metrics[name + "_ms"] = ms / pairs.size();
+        metrics[name + "_settled"] = double(settled) / pairs.size();
+
+        if (expected.empty()) {
+            expected = std::move(distances);
+            return;
+        }
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            const double a = distances[i];
+            const double b = expected[i];
+            if (a == b || std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b))) continue;
+            mismatches << QString("%1 %2->%3: %4, dijkstra %5").arg(name).arg(pairs[i].first).arg(pairs[i].second)
+                              .arg(a).arg(b);
+            break;
+        }
+    };
+    auto report = [&]() {
+        if (mismatches.isEmpty()) return true;
+        if (error) *error = "distance mismatch: " + mismatches.join("; ");
+        return false;
+    };
+
+    run("dijkstra", [&](int s, int t) { return engine.dijkstra(graph, s, t); });
+    run("bidirectional", [&](int s, int t) { return engine.bidirectional(graph, s, t); });
+    const EuclideanHeuristic euclidean(graph);
+    run("astar_euclidean", [&](int s, int t) { return engine.aStar(graph, s, t, euclidean); });
+
+    std::unique_ptr<LandmarkHeuristic> landmarks;
+    metrics["alt_preprocess_ms"] = timeMs([&]() { landmarks.reset(new LandmarkHeuristic(graph)); });
+    run("astar_alt", [&](int s, int t) { return engine.aStar(graph, s, t, *landmarks, SearchControl()); });
+
+    if (n > options.maxHierarchyNodes) return report();
+    std::unique_ptr<ContractionHierarchy> hierarchy;
+    metrics["ch_preprocess_ms"] = timeMs([&]() { hierarchy.reset(new ContractionHierarchy(graph)); });
+    metrics["ch_shortcuts"] = hierarchy->shortcutCount();
+    run("ch", [&](int s, int t) { return engine.hierarchy(*hierarchy, s, t); });
+    return report();
+}
+
+void benchSpanning(const GraphModel& graph, QJsonObject& metrics)
+{
+    SpanningForest forest;
+    metrics["mst_kruskal_ms"] = timeMs([&]() { forest = SpanningTree::kruskal(graph); });
+    metrics["mst_weight"] = forest.totalWeight;
+    metrics["mst_prim_ms"] = timeMs([&]() { forest = SpanningTree::prim(graph); });
+    metrics["mst_boruvka_ms"] = timeMs([&]() { forest = SpanningTree::boruvka(graph); });
+}
+
+bool benchFormats(const GraphData& data, QJsonObject& metrics, QString* error)
+{
+    QBuffer json;
+    json.open(QIODevice::ReadWrite);
+    metrics["json_write_ms"] = timeMs([&]() { GraphIO::writeJson(&json, data, error); });
+    metrics["json_bytes"] = double(json.size());
+    json.seek(0);
+    GraphData loaded;
+    bool ok = true;
+    metrics["json_read_ms"] = timeMs([&]() { ok = GraphIO::readJson(&json, loaded, error); });
+    if (!ok) return false;
+
+    // The binary reader maps a file, so this one goes through the disk
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("bench.gvb");
+    metrics["binary_write_ms"] = timeMs([&]() { ok = GraphIO::save(fileName, data, error); });
+    if (!ok) return false;
+    metrics["binary_bytes"] = double(QFileInfo(fileName).size());
+    metrics["binary_read_ms"] = timeMs([&]() { ok = GraphIO::readBinary(fileName, loaded, error); });
+    if (!ok) return false;
+    // Headless path: CSR arrays straight from the mapping, no labels
+    metrics["binary_model_ms"] = timeMs([&]() {
+        BinaryGraphFile file;
+        ok = file.open(fileName, error);
+        if (ok) file.model();
+    });
+    return ok;
+}
+
+void benchScene(const GraphData& data, const Options& options, QJsonObject& metrics)
+{
+    StateMouse state = Insert_State;
+    GraphScene scene(&state);
+    GraphView view(&scene);
+    view.resize(1280, 800);
+
+    metrics["scene_load_ms"] = timeMs([&]() { scene.loadGraph(data); });
+    metrics["scene_bytes_per_element"] = PerfStats::instance()->sceneBytesPerElement;
+    {
+        // Same graph with compact items, in a scene of its own
+        auto info = staticInformation::instance();
+        info->compactItems = true;
+        GraphScene compact(&state);
+        metrics["scene_compact_load_ms"] = timeMs([&]() { compact.loadGraph(data); });
+        metrics["scene_compact_bytes_per_element"] = PerfStats::instance()->sceneBytesPerElement;
+        info->compactItems = false;
+    }
+    if (options.render) {
+        view.fitInView(scene.itemsBoundingRect(), Qt::KeepAspectRatio);
+        QImage frame(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+        auto render = [&]() {
+            frame.fill(Qt::white);
+            QPainter painter(&frame);
+            view.render(&painter);
+        };
+        metrics["render_ms"] = timeMs(render);
+
+        metrics["edge_layer_build_ms"] = timeMs([&]() { scene.setEdgeLayerEnabled(true); });
+        metrics["render_edge_layer_ms"] = timeMs(render);
+    }
+
+    // Deleting a large selection: every other node and its edges
+    QVector<NodeItem*> half;
+    for (int id = 0; id < scene.nodes().size(); id += 2) half.append(scene.nodes()[id]);
+    metrics["scene_remove_half_ms"] = timeMs([&]() { scene.removeNodes(half); });
+
+    metrics["scene_clear_ms"] = timeMs([&]() { scene.clearScene(); });
+}
+
+QList<int> parseSizes(const QString& text)
+{
+    QList<int> sizes;
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        QString value = part.trimmed().toLower();
+        int scale = 1;
+        if (value.endsWith("k")) scale = 1000;
+        if (value.endsWith("m")) scale = 1000000;
+        if (scale != 1) value.chop(1);
+        bool ok = false;
+        int size = value.toInt(&ok);
+        if (ok && size > 0) sizes.append(size * scale);
+    }
+    return sizes;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // Rendering needs a QPA platform but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("GraphVisualizer bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times shortest paths, MST, file formats, scene loading and rendering on synthetic graphs.");
+    parser.addHelpOption();
+    QCommandLineOption generatorsOption("generators", "Comma separated list of " + GraphGenerators::names().join(", ") + ".",
+                                        "names", GraphGenerators::names().join(','));
+    QCommandLineOption sizesOption("sizes", "Comma separated node counts, k/m suffixes allowed.", "sizes", "1k,10k,100k,1m");
+    QCommandLineOption queriesOption("queries", "Shortest path queries per graph.", "count", "20");
+    QCommandLineOption sceneOption("max-scene-nodes", "Skip scene and render timings above this node count.", "count", "200000");
+    QCommandLineOption hierarchyOption("max-ch-nodes", "Skip contraction hierarchy timings above this node count.", "count", "200000");
+    QCommandLineOption noRenderOption("no-render", "Skip offscreen rendering.");
+    QCommandLineOption outputOption({"o", "output"}, "Write the JSON report to a file instead of stdout.", "file");
+    parser.addOptions({generatorsOption, sizesOption, queriesOption, sceneOption, hierarchyOption, noRenderOption, outputOption});
+    parser.process(app);
+
+    Options options;
+    options.generators = parser.value(generatorsOption).split(',', Qt::SkipEmptyParts);
+    options.sizes = parseSizes(parser.value(sizesOption));
+    options.queries = qMax(1, parser.value(queriesOption).toInt());
+    options.maxSceneNodes = parser.value(sceneOption).toInt();
+    options.maxHierarchyNodes = parser.value(hierarchyOption).toInt();
+    options.render = !parser.isSet(noRenderOption);
+
+    QJsonArray results;
+    bool failed = false;
+    for (const QString& generator : std::as_const(options.generators)) {
+        for (int size : std::as_const(options.sizes)) {
+            QJsonObject record;
+            QJsonObject metrics;
+            record["generator"] = generator;
+
+            GraphData data;
+            bool known = true;
+            metrics["generate_ms"] = timeMs([&]() { known = GraphGenerators::generate(generator, size, data); });
+            if (!known) {
+                qWarning("Unknown generator %s", qPrintable(generator));
+                break;
+            }
+            record["nodes"] = int(data.nodes.size());
+            record["edges"] = double(data.edges.size());
+            qInfo("%s: %d nodes, %zu edges", qPrintable(generator), size, data.edges.size());
+
+            GraphModel graph;
+            metrics["model_build_ms"] = timeMs([&]() { graph = GraphIO::toModel(data); });
+            QStringList errors;
+            QString error;
+            if (!benchPaths(graph, options, metrics, &error)) errors << error;
+            benchSpanning(graph, metrics);
+
+            if (!benchFormats(data, metrics, &error)) errors << error;
+            if (!errors.isEmpty()) {
+                record["error"] = errors.join("; ");
+                failed = true;
+            }
+
+            if (size <= options.maxSceneNodes) benchScene(data, options, metrics);
+
+            record["metrics"] = metrics;
+            results.append(record);
+        }
+    }
+
+    QJsonObject report;
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qtVersion"] = QString(qVersion());
+    report["threads"] = QThread::idealThreadCount();
+#ifdef QT_DEBUG
+    report["build"] = "debug";
+#else
+    report["build"] = "release";
+#endif
+    report["queries"] = options.queries;
+    report["results"] = results;
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical("Cannot write %s", qPrintable(file.fileName()));
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return failed ? 2 : 0;
+}
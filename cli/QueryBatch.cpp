@@ -0,0 +1,342 @@
+#include "QueryBatch.h"
+#include "GraphIO.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QThread>
+
+#include <limits>
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+QByteArray csvNumber(double value)
+{
+    return value < kInfinity ? QByteArray::number(value, 'g', 17) : QByteArray("inf");
+}
+
+// JSON has no infinity; unreachable distances are written as null
+QJsonValue jsonDistance(double value)
+{
+    return value < kInfinity ? QJsonValue(value) : QJsonValue();
+}
+
+const char* kindName(BatchKind kind)
+{
+    switch (kind) {
+    case Path_Batch: return "path";
+    case Spanning_Batch: return "mst";
+    case Matrix_Batch: return "matrix";
+    }
+    return "";
+}
+
+bool parsePathAlgorithm(const QString& name, BatchQuery& query)
+{
+    if (name == "dijkstra") {
+        query.pathAlgorithm = Dijkstra_Algorithm;
+    } else if (name == "bidirectional") {
+        query.pathAlgorithm = Bidirectional_Algorithm;
+    } else if (name == "astar") {
+        query.pathAlgorithm = AStar_Algorithm;
+        query.heuristic = Euclidean_Heuristic;
+    } else if (name == "alt") {
+        query.pathAlgorithm = AStar_Algorithm;
+        query.heuristic = Landmark_Heuristic;
+    } else if (name == "ch") {
+        query.pathAlgorithm = Hierarchy_Algorithm;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseSpanningAlgorithm(const QString& name, BatchQuery& query)
+{
+    if (name == "kruskal") {
+        query.spanningAlgorithm = Kruskal_Algorithm;
+    } else if (name == "prim") {
+        query.spanningAlgorithm = Prim_Algorithm;
+    } else if (name == "boruvka") {
+        query.spanningAlgorithm = Boruvka_Algorithm;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+PathResult runPath(ShortestPathEngine& engine, const BatchContext& context, const BatchQuery& query)
+{
+    const GraphModel& graph = *context.graph;
+    const int source = query.sources.front();
+    const int target = query.targets.front();
+    switch (query.pathAlgorithm) {
+    case Dijkstra_Algorithm:
+        return engine.dijkstra(graph, source, target);
+    case Bidirectional_Algorithm:
+        return engine.bidirectional(graph, source, target);
+    case Hierarchy_Algorithm:
+        return engine.hierarchy(*context.hierarchy, source, target);
+    case AStar_Algorithm:
+        break;
+    }
+    if (query.heuristic == Landmark_Heuristic) return engine.aStar(graph, source, target, *context.landmarks);
+    return engine.aStar(graph, source, target, *context.euclidean);
+}
+
+QStringList pathNames(const BatchContext& context, const BatchQuery& query, const PathResult& path)
+{
+    QStringList names;
+    if (!path.found()) return names;
+    names << context.name(query.sources.front());
+    for (int edge : path.edges) names << context.name(context.graph->edge(edge).target);
+    return names;
+}
+
+}
+
+std::vector<BatchQuery> QueryBatch::parse(QIODevice* device, const std::function<int(const QString&)>& resolve,
+                                          QStringList& errors)
+{
+    std::vector<BatchQuery> queries;
+    const QRegularExpression whitespace("\\s+");
+    int lineNumber = 0;
+    while (!device->atEnd()) {
+        const QString line = QString::fromUtf8(device->readLine()).trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        const QStringList words = line.split(whitespace, Qt::SkipEmptyParts);
+        auto fail = [&](const QString& message) { errors << QString("line %1: %2").arg(lineNumber).arg(message); };
+        auto nodes = [&](const QString& list, std::vector<int>& ids) {
+            for (const QString& name : list.split(',', Qt::SkipEmptyParts)) {
+                const int id = resolve(name);
+                if (id < 0) {
+                    fail("unknown node " + name);
+                    return false;
+                }
+                ids.push_back(id);
+            }
+            return !ids.empty();
+        };
+
+        BatchQuery query;
+        query.line = lineNumber;
+        query.algorithm = words.size() > 1 ? words[1].toLower() : QString();
+        const QString kind = words[0].toLower();
+        if (kind == "path") {
+            query.kind = Path_Batch;
+            if (words.size() != 4) {
+                fail("expected: path <algorithm> <source> <target>");
+                continue;
+            }
+            if (!parsePathAlgorithm(query.algorithm, query)) {
+                fail("unknown path algorithm " + words[1]);
+                continue;
+            }
+            if (!nodes(words[2], query.sources) || !nodes(words[3], query.targets)) continue;
+            if (query.sources.size() != 1 || query.targets.size() != 1) {
+                fail("a path query takes one source and one target");
+                continue;
+            }
+        } else if (kind == "mst") {
+            query.kind = Spanning_Batch;
+            if (words.size() != 2 || !parseSpanningAlgorithm(query.algorithm, query)) {
+                fail("expected: mst <kruskal|prim|boruvka>");
+                continue;
+            }
+        } else if (kind == "matrix") {
+            query.kind = Matrix_Batch;
+            query.algorithm.clear();
+            if (words.size() != 3) {
+                fail("expected: matrix <sources> <targets>");
+                continue;
+            }
+            if (!nodes(words[1], query.sources) || !nodes(words[2], query.targets)) continue;
+        } else {
+            fail("unknown query " + words[0]);
+            continue;
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+bool QueryBatch::needsHierarchy(const std::vector<BatchQuery>& queries)
+{
+    for (const BatchQuery& query : queries) {
+        if (query.kind == Path_Batch && query.pathAlgorithm == Hierarchy_Algorithm) return true;
+    }
+    return false;
+}
+
+bool QueryBatch::needsLandmarks(const std::vector<BatchQuery>& queries)
+{
+    for (const BatchQuery& query : queries) {
+        if (query.kind == Path_Batch && query.heuristic == Landmark_Heuristic) return true;
+    }
+    return false;
+}
+
+bool QueryBatch::needsEuclidean(const std::vector<BatchQuery>& queries)
+{
+    for (const BatchQuery& query : queries) {
+        if (query.kind == Path_Batch && query.heuristic == Euclidean_Heuristic) return true;
+    }
+    return false;
+}
+
+bool QueryBatch::hasPathQueries(const std::vector<BatchQuery>& queries)
+{
+    for (const BatchQuery& query : queries) {
+        if (query.kind == Path_Batch) return true;
+    }
+    return false;
+}
+
+std::vector<BatchResult> QueryBatch::run(const BatchContext& context, const std::vector<BatchQuery>& queries)
+{
+    GV_TRACE_SCOPE("QueryBatch::run");
+    std::vector<BatchResult> results(queries.size());
+
+    std::vector<int> paths;
+    for (int i = 0; i < int(queries.size()); ++i) {
+        if (queries[i].kind == Path_Batch) paths.push_back(i);
+    }
+    // A few chunks per thread keeps the pool busy when query costs differ
+    const int grain = qMax(1, int(paths.size()) / (QThread::idealThreadCount() * 4));
+    // Every path algorithm here settles nodes Dijkstra-style and would
+    // return wrong distances; matrix queries handle negative weights
+    const bool negative = context.graph->hasNegativeWeight();
+    parallelFor(int(paths.size()), [&](int begin, int end) {
+        ShortestPathEngine engine;
+        for (int i = begin; i < end; ++i) {
+            const BatchQuery& query = queries[paths[i]];
+            BatchResult& result = results[paths[i]];
+            if (negative) {
+                result.error = "negative edge weights";
+                continue;
+            }
+            if (query.pathAlgorithm == Hierarchy_Algorithm && !context.hierarchy) {
+                result.error = "no contraction hierarchy";
+                continue;
+            }
+            QElapsedTimer timer;
+            timer.start();
+            result.path = runPath(engine, context, query);
+            result.ms = timer.nsecsElapsed() / 1e6;
+        }
+    }, grain);
+
+    for (int i = 0; i < int(queries.size()); ++i) {
+        const BatchQuery& query = queries[i];
+        BatchResult& result = results[i];
+        QElapsedTimer timer;
+        timer.start();
+        if (query.kind == Spanning_Batch) {
+            result.forest = SpanningTree::run(*context.graph, query.spanningAlgorithm);
+        } else if (query.kind == Matrix_Batch) {
+            result.table = DistanceMatrix::compute(*context.graph, query.sources, query.targets);
+            if (result.table.negativeCycle) result.error = "negative cycle";
+        } else {
+            continue;
+        }
+        result.ms = timer.nsecsElapsed() / 1e6;
+    }
+    return results;
+}
+
+QByteArray QueryBatch::toJson(const BatchContext& context, const std::vector<BatchQuery>& queries,
+                              const std::vector<BatchResult>& results)
+{
+    QJsonArray records;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const BatchQuery& query = queries[i];
+        const BatchResult& result = results[i];
+        QJsonObject record;
+        record["line"] = query.line;
+        record["kind"] = kindName(query.kind);
+        if (!query.algorithm.isEmpty()) record["algorithm"] = query.algorithm;
+        record["ms"] = result.ms;
+        if (!result.error.isEmpty()) record["error"] = result.error;
+
+        if (query.kind == Path_Batch) {
+            record["source"] = context.name(query.sources.front());
+            record["target"] = context.name(query.targets.front());
+            record["found"] = result.path.found();
+            record["distance"] = jsonDistance(result.path.distance);
+            record["settled"] = result.path.settled;
+            record["path"] = QJsonArray::fromStringList(pathNames(context, query, result.path));
+        } else if (query.kind == Spanning_Batch) {
+            record["weight"] = result.forest.totalWeight;
+            record["edges"] = int(result.forest.edges.size());
+            record["components"] = result.forest.components;
+        } else {
+            QStringList sources, targets;
+            for (int node : query.sources) sources << context.name(node);
+            for (int node : query.targets) targets << context.name(node);
+            record["sources"] = QJsonArray::fromStringList(sources);
+            record["targets"] = QJsonArray::fromStringList(targets);
+            QJsonArray rows;
+            for (int row = 0; row < int(query.sources.size()) && !result.table.values.empty(); ++row) {
+                QJsonArray cells;
+                for (int column = 0; column < int(query.targets.size()); ++column) {
+                    cells.append(jsonDistance(result.table.at(row, column)));
+                }
+                rows.append(cells);
+            }
+            record["distances"] = rows;
+        }
+        records.append(record);
+    }
+
+    QJsonObject report;
+    report["nodes"] = context.graph->nodeCount();
+    report["edges"] = context.graph->edgeCount();
+    report["threads"] = QThread::idealThreadCount();
+    report["results"] = records;
+    return QJsonDocument(report).toJson();
+}
+
+QByteArray QueryBatch::toCsv(const BatchContext& context, const std::vector<BatchQuery>& queries,
+                             const std::vector<BatchResult>& results)
+{
+    QByteArray csv = "line,kind,algorithm,source,target,found,distance,settled,ms,detail\n";
+    auto row = [&](const BatchQuery& query, const BatchResult& result, const QString& source, const QString& target,
+                   const QByteArray& found, const QByteArray& distance, const QByteArray& settled, const QString& detail) {
+        csv += QByteArray::number(query.line) + ',' + kindName(query.kind) + ',' + GraphIO::csvField(query.algorithm) + ','
+               + GraphIO::csvField(source) + ',' + GraphIO::csvField(target) + ',' + found + ',' + distance + ',' + settled + ','
+               + QByteArray::number(result.ms, 'f', 3) + ',' + GraphIO::csvField(result.error.isEmpty() ? detail : result.error)
+               + '\n';
+    };
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const BatchQuery& query = queries[i];
+        const BatchResult& result = results[i];
+        if (query.kind == Path_Batch) {
+            row(query, result, context.name(query.sources.front()), context.name(query.targets.front()),
+                result.path.found() ? "true" : "false", csvNumber(result.path.distance),
+                QByteArray::number(result.path.settled), pathNames(context, query, result.path).join(' '));
+        } else if (query.kind == Spanning_Batch) {
+            row(query, result, QString(), QString(), "", csvNumber(result.forest.totalWeight), "",
+                QString("%1 edges, %2 components").arg(int(result.forest.edges.size())).arg(result.forest.components));
+        } else if (result.table.values.empty()) {
+            row(query, result, QString(), QString(), "", "", "", QString());
+        } else {
+            for (int r = 0; r < int(query.sources.size()); ++r) {
+                for (int c = 0; c < int(query.targets.size()); ++c) {
+                    const double distance = result.table.at(r, c);
+                    row(query, result, context.name(query.sources[r]), context.name(query.targets[c]),
+                        distance < kInfinity ? "true" : "false", csvNumber(distance), "", QString());
+                }
+            }
+        }
+    }
+    return csv;
+}
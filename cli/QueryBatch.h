@@ -0,0 +1,83 @@
+#ifndef QUERYBATCH_H
+#define QUERYBATCH_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QStringList>
+
+#include <functional>
+#include <vector>
+
+#include "GraphModel.h"
+#include "PathQuery.h"
+#include "SpanningTree.h"
+#include "DistanceMatrix.h"
+
+enum BatchKind{
+    Path_Batch,
+    Spanning_Batch,
+    Matrix_Batch
+};
+
+// One line of a query file:
+//   path <dijkstra|bidirectional|astar|alt|ch> <source> <target>
+//   mst <kruskal|prim|boruvka>
+//   matrix <source,source,..> <target,target,..>
+// Blank lines and lines starting with '#' are skipped.
+struct BatchQuery {
+    BatchKind kind = Path_Batch;
+    int line = 0;
+    QString algorithm;      // as written in the file
+    PathAlgorithm pathAlgorithm = Dijkstra_Algorithm;
+    HeuristicMode heuristic = No_Heuristic;
+    SpanningAlgorithm spanningAlgorithm = Kruskal_Algorithm;
+    std::vector<int> sources;   // one each for path queries
+    std::vector<int> targets;
+};
+
+struct BatchResult {
+    PathResult path;
+    SpanningForest forest;
+    DistanceTable table;
+    double ms = 0;
+    QString error;
+};
+
+// What a batch needs besides the graph, built once before it runs
+struct BatchContext {
+    const GraphModel* graph = nullptr;
+    const ContractionHierarchy* hierarchy = nullptr;    // for "ch" queries
+    const LandmarkHeuristic* landmarks = nullptr;       // for "alt" queries
+    const EuclideanHeuristic* euclidean = nullptr;      // for "astar" queries
+    std::function<QString(int node)> name;              // node label for output
+};
+
+namespace QueryBatch {
+
+// Node names go through `resolve`, which returns -1 for unknown names.
+// Malformed lines are reported in `errors` and skipped.
+std::vector<BatchQuery> parse(QIODevice* device, const std::function<int(const QString&)>& resolve,
+                              QStringList& errors);
+
+bool needsHierarchy(const std::vector<BatchQuery>& queries);
+bool needsLandmarks(const std::vector<BatchQuery>& queries);
+bool needsEuclidean(const std::vector<BatchQuery>& queries);
+bool hasPathQueries(const std::vector<BatchQuery>& queries);
+
+// Path queries are spread over the global thread pool in chunks, each
+// with its own ShortestPathEngine. MST and matrix queries run one after
+// another, since each of them already uses the whole pool. On a graph
+// with negative edge weights path queries fail with an error; matrix
+// queries still run (Johnson).
+std::vector<BatchResult> run(const BatchContext& context, const std::vector<BatchQuery>& queries);
+
+QByteArray toJson(const BatchContext& context, const std::vector<BatchQuery>& queries,
+                  const std::vector<BatchResult>& results);
+// One row per path or MST query and one per matrix cell:
+// line,kind,algorithm,source,target,found,distance,settled,ms,detail
+QByteArray toCsv(const BatchContext& context, const std::vector<BatchQuery>& queries,
+                 const std::vector<BatchResult>& results);
+
+}
+
+#endif // QUERYBATCH_H
@@ -0,0 +1,18 @@
+# Headless batch query runner, no GUI modules:
+#   qmake cli/cli.pro && make && ./graphcli graph.gvb -q queries.txt -o results.json
+
+QT       = core concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = graphcli
+
+include(../core.pri)
+
+SOURCES += \
+    main.cpp \
+    QueryBatch.cpp
+
+HEADERS += \
+    QueryBatch.h
@@ -0,0 +1,171 @@
+// Headless query runner: loads a graph file and answers a batch of
+// shortest path, MST and distance matrix queries without a display.
+// Results are written as JSON or CSV.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+
+#include "ContractionHierarchy.h"
+#include "GraphIO.h"
+#include "Heuristics.h"
+#include "LabelIndex.h"
+#include "QueryBatch.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("GraphVisualizer cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Answers a batch of graph queries, one per line:\n"
+        "  path <dijkstra|bidirectional|astar|alt|ch> <source> <target>\n"
+        "  mst <kruskal|prim|boruvka>\n"
+        "  matrix <source,source,..> <target,target,..>\n"
+        "Nodes are given by label, or by id with --ids.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("graph", "Graph file (.json or .gvb).");
+    QCommandLineOption queriesOption({"q", "queries"}, "Query file; reads stdin if omitted or \"-\".", "file", "-");
+    QCommandLineOption outputOption({"o", "output"}, "Write results to a file instead of stdout.", "file");
+    QCommandLineOption formatOption({"f", "format"}, "json or csv; defaults to the output file suffix, else json.", "format");
+    QCommandLineOption idsOption("ids", "Nodes in queries are numeric ids rather than labels.");
+    QCommandLineOption threadsOption({"j", "threads"}, "Worker threads (default: one per core).", "count");
+    parser.addOptions({queriesOption, outputOption, formatOption, idsOption, threadsOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) parser.showHelp(1);
+    if (parser.isSet(threadsOption)) {
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value(threadsOption).toInt()));
+    }
+    QString format = parser.value(formatOption).toLower();
+    if (format.isEmpty()) {
+        format = QFileInfo(parser.value(outputOption)).suffix().toLower() == "csv" ? "csv" : "json";
+    }
+    if (format != "json" && format != "csv") {
+        qCritical("Unknown format %s", qPrintable(format));
+        return 1;
+    }
+
+    const QString graphFile = parser.positionalArguments().first();
+    // Binary files stay mapped: the model comes straight from the CSR
+    // block and labels are only decoded when a query or result needs them
+    BinaryGraphFile binary;
+    GraphData data;
+    GraphModel graph;
+    std::function<QString(int)> label;
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    if (GraphIO::isBinaryFile(graphFile)) {
+        if (!binary.open(graphFile, &error)) {
+            qCritical("%s", qPrintable(error));
+            return 1;
+        }
+        graph = binary.model();
+        label = [&](int node) { return binary.label(node); };
+    } else {
+        if (!GraphIO::load(graphFile, data, &error)) {
+            qCritical("%s", qPrintable(error));
+            return 1;
+        }
+        graph = GraphIO::toModel(data);
+        label = [&](int node) { return data.nodes[node].label; };
+    }
+    qInfo("Loaded %d nodes, %d edges in %lld ms", graph.nodeCount(), graph.edgeCount(), timer.elapsed());
+
+    // Parse
+    const bool byId = parser.isSet(idsOption);
+    LabelIndex labels;
+    if (!byId) {
+        for (int u = 0; u < graph.nodeCount(); ++u) labels.insert(label(u), u);
+    }
+    auto resolve = [&](const QString& name) {
+        if (!byId) return labels.find(name);
+        bool ok = false;
+        const int id = name.toInt(&ok);
+        return ok && id >= 0 && id < graph.nodeCount() ? id : -1;
+    };
+
+    QFile queryFile;
+    const QString queryPath = parser.value(queriesOption);
+    bool opened = false;
+    if (queryPath == "-") {
+        opened = queryFile.open(stdin, QIODevice::ReadOnly);
+    } else {
+        queryFile.setFileName(queryPath);
+        opened = queryFile.open(QIODevice::ReadOnly);
+    }
+    if (!opened) {
+        qCritical("Cannot read %s", qPrintable(queryPath == "-" ? QString("stdin") : queryPath));
+        return 1;
+    }
+    QStringList errors;
+    const std::vector<BatchQuery> queries = QueryBatch::parse(&queryFile, resolve, errors);
+    for (const QString& message : std::as_const(errors)) qWarning("%s", qPrintable(message));
+
+    // Preprocessing shared by the queries that need it
+    BatchContext context;
+    context.graph = &graph;
+    context.name = [&](int node) {
+        const QString name = byId ? QString() : label(node);
+        return name.isEmpty() ? QString::number(node) : name;
+    };
+
+    const bool negative = graph.hasNegativeWeight();
+    if (negative && QueryBatch::hasPathQueries(queries)) {
+        qWarning("The graph has negative edge weights; path queries are skipped, use matrix queries instead");
+    }
+
+    std::unique_ptr<ContractionHierarchy> hierarchy;
+    if (QueryBatch::needsHierarchy(queries) && !negative) {
+        timer.restart();
+        hierarchy.reset(new ContractionHierarchy());
+        const QString sidecar = ContractionHierarchy::sidecarPath(graphFile);
+        if (QFile::exists(sidecar) && hierarchy->load(sidecar, graph, &error)) {
+            qInfo("Loaded contraction hierarchy in %lld ms", timer.elapsed());
+        } else {
+            hierarchy.reset(new ContractionHierarchy(graph));
+            qInfo("Built contraction hierarchy in %lld ms", timer.elapsed());
+        }
+        context.hierarchy = hierarchy.get();
+    }
+    std::unique_ptr<LandmarkHeuristic> landmarks;
+    if (QueryBatch::needsLandmarks(queries) && !negative) {
+        landmarks.reset(new LandmarkHeuristic(graph));
+        context.landmarks = landmarks.get();
+    }
+    std::unique_ptr<EuclideanHeuristic> euclidean;
+    if (QueryBatch::needsEuclidean(queries) && !negative) {
+        euclidean.reset(new EuclideanHeuristic(graph));
+        context.euclidean = euclidean.get();
+    }
+
+    // Run
+    timer.restart();
+    const std::vector<BatchResult> results = QueryBatch::run(context, queries);
+    qInfo("Answered %zu queries in %lld ms on %d threads", queries.size(), timer.elapsed(),
+          QThreadPool::globalInstance()->maxThreadCount());
+
+    const QByteArray output = format == "csv" ? QueryBatch::toCsv(context, queries, results)
+                                              : QueryBatch::toJson(context, queries, results);
+    if (parser.isSet(outputOption)) {
+        QSaveFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(output) < 0 || !file.commit()) {
+            qCritical("Cannot write %s", qPrintable(file.fileName()));
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << output;
+    }
+    return errors.isEmpty() ? 0 : 2;
+}
@@ -0,0 +1,53 @@
+# Headless graph engine and file formats: QtCore and QtConcurrent only.
+# Shared by engine.pri and the command-line target (cli/).
+#
+# CONFIG += trace compiles in the GV_TRACE_* scopes (see Trace.h).
+
+QT += concurrent
+
+trace: DEFINES += GV_TRACE
+
+# Trace::peakMemoryBytes()/heapBytes() read the working set through
+# GetProcessMemoryInfo, which lives in psapi with PSAPI_VERSION 1
+win32: LIBS += -lpsapi
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/AlgorithmTrace.cpp \
+    $$PWD/ContractionHierarchy.cpp \
+    $$PWD/DistanceMatrix.cpp \
+    $$PWD/ForceLayout.cpp \
+    $$PWD/GraphBinary.cpp \
+    $$PWD/GraphModel.cpp \
+    $$PWD/GraphIO.cpp \
+    $$PWD/Heuristics.cpp \
+    $$PWD/JsonStreamReader.cpp \
+    $$PWD/LabelIndex.cpp \
+    $$PWD/LayoutRunner.cpp \
+    $$PWD/NodeGridIndex.cpp \
+    $$PWD/PathQuery.cpp \
+    $$PWD/PathTreeCache.cpp \
+    $$PWD/ShortestPath.cpp \
+    $$PWD/SpanningTree.cpp \
+    $$PWD/Trace.cpp
+
+HEADERS += \
+    $$PWD/AlgorithmTrace.h \
+    $$PWD/ContractionHierarchy.h \
+    $$PWD/DistanceMatrix.h \
+    $$PWD/ForceLayout.h \
+    $$PWD/GraphModel.h \
+    $$PWD/GraphIO.h \
+    $$PWD/Heuristics.h \
+    $$PWD/JsonStreamReader.h \
+    $$PWD/LabelIndex.h \
+    $$PWD/LayoutRunner.h \
+    $$PWD/NodeGridIndex.h \
+    $$PWD/Parallel.h \
+    $$PWD/PathQuery.h \
+    $$PWD/PathTreeCache.h \
+    $$PWD/IndexedHeap.h \
+    $$PWD/ShortestPath.h \
+    $$PWD/SpanningTree.h \
+    $$PWD/Trace.h
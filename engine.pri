@@ -0,0 +1,26 @@
+# Graph engine, file formats and scene classes, shared by the editor and
+# the bench (bench/). Headless targets include core.pri instead.
+
+include($$PWD/core.pri)
+
+# Image export writes SVG through QtSvg and deflates PNG rows with zlib:
+# the system library on Unix, the copy bundled with and exported by QtCore
+# elsewhere (Windows has no system zlib).
+QT += svg
+unix {
+    LIBS += -lz
+} else {
+    INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+}
+
+SOURCES += \
+    $$PWD/Graph.cpp \
+    $$PWD/EdgeLayerItem.cpp \
+    $$PWD/ImageExport.cpp \
+    $$PWD/TracePlayer.cpp
+
+HEADERS += \
+    $$PWD/Graph.h \
+    $$PWD/EdgeLayerItem.h \
+    $$PWD/ImageExport.h \
+    $$PWD/TracePlayer.h
@@ -1,11 +1,21 @@
 #include "mainwindow.h"
+#include "Trace.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+#ifdef GV_TRACE
+    // GV_TRACE_FILE=trace.json records a Chrome trace until exit
+    const QString traceFile = qEnvironmentVariable("GV_TRACE_FILE");
+    if (!traceFile.isEmpty() && !Trace::start(traceFile)) {
+        qWarning("GV_TRACE_FILE: cannot write %s, tracing is off", qPrintable(traceFile));
+    }
+#endif
     MainWindow w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+    Trace::stop();
+    return result;
 }